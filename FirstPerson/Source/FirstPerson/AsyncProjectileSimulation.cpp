@@ -0,0 +1,224 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "AsyncProjectileSimulation.h"
+#include "ProjectileBallistics.h"
+#include "FirstPerson.h"
+#include "Chaos/ISpatialAcceleration.h"
+#include "Chaos/ParticleHandle.h"
+#include "Chaos/ImplicitObject.h"
+#include "Chaos/PBDRigidsEvolutionGBF.h"
+#include "PBDRigidsSolver.h"
+#include "Engine/EngineTypes.h"
+
+DECLARE_CYCLE_STAT(TEXT("Async Projectiles Step"), STAT_AsyncProjectilesStep, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Async Projectiles Live"), STAT_AsyncProjectilesLive, STATGROUP_FirstPerson);
+
+/** Object channel of the "Projectile" collision profile set up in DefaultEngine.ini */
+static constexpr ECollisionChannel AsyncProjectileChannel = ECC_GameTraceChannel1;
+
+/**
+ *  Finds the closest blocking hit along a projectile's path in the physics thread acceleration structure
+ */
+struct FAsyncProjectileRaycastVisitor final : public Chaos::ISpatialVisitor<Chaos::FAccelerationStructureHandle, Chaos::FReal>
+{
+	using FVisitorData = Chaos::TSpatialVisitorData<Chaos::FAccelerationStructureHandle>;
+
+	FAsyncProjectileRaycastVisitor(const Chaos::FVec3& InStart, const Chaos::FVec3& InDir, Chaos::FReal InRadius, const IPhysicsProxyBase* InIgnoredProxy)
+		: Start(InStart)
+		, Dir(InDir)
+		, Radius(InRadius)
+		, IgnoredProxy(InIgnoredProxy)
+	{}
+
+	virtual bool Overlap(const FVisitorData& Instance) override { return true; }
+	virtual bool Sweep(const FVisitorData& Instance, Chaos::FQueryFastData& CurData) override { return true; }
+
+	virtual bool Raycast(const FVisitorData& Instance, Chaos::FQueryFastData& CurData) override
+	{
+		const Chaos::FGeometryParticleHandle* Particle = Instance.Payload.GetGeometryParticleHandle_PhysicsThread();
+
+		// ignore the shooter
+		if (!Particle || Particle->PhysicsProxy() == IgnoredProxy)
+		{
+			return true;
+		}
+
+		const Chaos::FRigidTransform3 ParticleTransform(Particle->GetX(), Particle->GetR());
+		const Chaos::FVec3 LocalStart = ParticleTransform.InverseTransformPositionNoScale(Start);
+		const Chaos::FVec3 LocalDir = ParticleTransform.InverseTransformVectorNoScale(Dir);
+
+		for (const TUniquePtr<Chaos::FShapeInstance>& Shape : Particle->ShapeInstances())
+		{
+			// only shapes that block the projectile channel
+			if (!Shape->GetQueryEnabled() || (Shape->GetQueryData().Word1 & ECC_TO_BITFIELD(AsyncProjectileChannel)) == 0)
+			{
+				continue;
+			}
+
+			const Chaos::FImplicitObject* Geometry = Shape->GetGeometry();
+			if (!Geometry)
+			{
+				continue;
+			}
+
+			Chaos::FReal Time;
+			Chaos::FVec3 Position;
+			Chaos::FVec3 Normal;
+			int32 FaceIndex;
+
+			if (Geometry->Raycast(LocalStart, LocalDir, CurData.CurrentLength, Radius, Time, Position, Normal, FaceIndex) && Time < CurData.CurrentLength)
+			{
+				// shrink the ray so the acceleration structure skips everything further away
+				CurData.SetLength(Time);
+
+				bHit = true;
+				HitPosition = ParticleTransform.TransformPositionNoScale(Position);
+				HitNormal = ParticleTransform.TransformVectorNoScale(Normal);
+				HitProxy = Particle->PhysicsProxy();
+			}
+		}
+
+		return true;
+	}
+
+	const Chaos::FVec3 Start;
+	const Chaos::FVec3 Dir;
+	const Chaos::FReal Radius;
+	const IPhysicsProxyBase* IgnoredProxy;
+
+	bool bHit = false;
+	Chaos::FVec3 HitPosition = Chaos::FVec3::ZeroVector;
+	Chaos::FVec3 HitNormal = Chaos::FVec3::ZeroVector;
+	IPhysicsProxyBase* HitProxy = nullptr;
+};
+
+void FAsyncProjectileSimCallback::OnPreSimulate_Internal()
+{
+	SCOPE_CYCLE_COUNTER(STAT_AsyncProjectilesStep);
+
+	if (const FAsyncProjectileInput* Input = GetConsumerInput_Internal())
+	{
+		ConsumeLaunches(*Input);
+	}
+
+	SET_DWORD_STAT(STAT_AsyncProjectilesLive, Positions.Num());
+
+	// fixed steps keep trajectories identical to the game thread simulation, whatever the physics rate
+	const int32 Steps = FProjectileBallistics::ConsumeSteps(StepAccumulator, GetDeltaTime_Internal());
+
+	if (Steps == 0 || Positions.IsEmpty())
+	{
+		return;
+	}
+
+	const Chaos::FPBDRigidsSolver* Solver = static_cast<const Chaos::FPBDRigidsSolver*>(GetSolver());
+	const Chaos::ISpatialAcceleration<Chaos::FAccelerationStructureHandle, Chaos::FReal, 3>* SpatialAcceleration = Solver->GetEvolution()->GetSpatialAcceleration();
+
+	FAsyncProjectileOutput& Output = GetProducerOutputData_Internal();
+
+	// keep the start points for the raycasts
+	TArray<FVector> Starts(Positions);
+	TArray<FVector> StartVelocities(Velocities);
+
+	for (int32 Step = 0; Step < Steps; ++Step)
+	{
+		FProjectileBallistics::Step(Positions, Velocities, GravityZs, Drags);
+	}
+
+	const float SteppedTime = Steps * FProjectileBallistics::FixedStep;
+
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		Ages[Index] += SteppedTime;
+
+		const FVector Path = Positions[Index] - Starts[Index];
+		const double PathLength = Path.Size();
+
+		if (SpatialAcceleration && PathLength > UE_KINDA_SMALL_NUMBER)
+		{
+			FAsyncProjectileRaycastVisitor Visitor(Starts[Index], Path / PathLength, Radii[Index], IgnoredProxies[Index]);
+			SpatialAcceleration->Raycast(Starts[Index], Visitor.Dir, PathLength, Visitor);
+
+			if (Visitor.bHit)
+			{
+				FAsyncProjectileEvent& Event = Output.Events.AddDefaulted_GetRef();
+				Event.Id = Ids[Index];
+				Event.Location = Visitor.HitPosition;
+				Event.Normal = Visitor.HitNormal;
+				Event.Velocity = StartVelocities[Index];
+				Event.HitProxy = Visitor.HitProxy;
+				Event.bHit = true;
+
+				if (BouncesLeft[Index] > 0)
+				{
+					// bounce off the surface from the hit point
+					--BouncesLeft[Index];
+					Positions[Index] = Visitor.HitPosition + Visitor.HitNormal * UE_KINDA_SMALL_NUMBER;
+					Velocities[Index] = FProjectileBallistics::Bounce(StartVelocities[Index], Visitor.HitNormal, Restitutions[Index], Frictions[Index]);
+
+				} else {
+
+					Event.bRemoved = true;
+					RemoveProjectileAtSwap(Index);
+				}
+
+				continue;
+			}
+		}
+
+		// expire projectiles that flew for too long
+		if (Ages[Index] > MaxLifetimes[Index])
+		{
+			FAsyncProjectileEvent& Event = Output.Events.AddDefaulted_GetRef();
+			Event.Id = Ids[Index];
+			Event.Location = Positions[Index];
+			Event.bRemoved = true;
+
+			RemoveProjectileAtSwap(Index);
+		}
+	}
+}
+
+void FAsyncProjectileSimCallback::ConsumeLaunches(const FAsyncProjectileInput& Input)
+{
+	for (const FAsyncProjectileLaunch& Launch : Input.Launches)
+	{
+		// ids only go up, so anything at or below the last one was already added by an earlier step
+		if (Launch.Id <= LastLaunchId)
+		{
+			continue;
+		}
+
+		LastLaunchId = Launch.Id;
+
+		Ids.Add(Launch.Id);
+		Positions.Add(Launch.Position);
+		Velocities.Add(Launch.Velocity);
+		Radii.Add(Launch.Radius);
+		GravityZs.Add(Launch.GravityZ);
+		Drags.Add(Launch.Drag);
+		Restitutions.Add(Launch.Restitution);
+		Frictions.Add(Launch.Friction);
+		Ages.Add(0.0f);
+		MaxLifetimes.Add(Launch.MaxLifetime);
+		BouncesLeft.Add(Launch.MaxBounces);
+		IgnoredProxies.Add(Launch.IgnoredProxy);
+	}
+}
+
+void FAsyncProjectileSimCallback::RemoveProjectileAtSwap(int32 Index)
+{
+	Ids.RemoveAtSwap(Index, EAllowShrinking::No);
+	Positions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Velocities.RemoveAtSwap(Index, EAllowShrinking::No);
+	Radii.RemoveAtSwap(Index, EAllowShrinking::No);
+	GravityZs.RemoveAtSwap(Index, EAllowShrinking::No);
+	Drags.RemoveAtSwap(Index, EAllowShrinking::No);
+	Restitutions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Frictions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Ages.RemoveAtSwap(Index, EAllowShrinking::No);
+	MaxLifetimes.RemoveAtSwap(Index, EAllowShrinking::No);
+	BouncesLeft.RemoveAtSwap(Index, EAllowShrinking::No);
+	IgnoredProxies.RemoveAtSwap(Index, EAllowShrinking::No);
+}
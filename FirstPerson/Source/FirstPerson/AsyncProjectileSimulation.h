@@ -0,0 +1,117 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+
+class IPhysicsProxyBase;
+
+/**
+ *  A projectile handed over to the physics thread
+ */
+struct FAsyncProjectileLaunch
+{
+	/** Id used to report events back to the game thread. Increases with every launch */
+	int32 Id = INDEX_NONE;
+
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	float Radius = 0.0f;
+	float GravityZ = 0.0f;
+	float Drag = 0.0f;
+	float Restitution = 0.0f;
+	float Friction = 0.0f;
+	float MaxLifetime = 0.0f;
+	uint8 MaxBounces = 0;
+
+	/** Physics proxy of the shooter, so projectiles don't hit it. Only compared against, never dereferenced */
+	const IPhysicsProxyBase* IgnoredProxy = nullptr;
+};
+
+/**
+ *  Something that happened to a projectile on the physics thread
+ */
+struct FAsyncProjectileEvent
+{
+	int32 Id = INDEX_NONE;
+
+	/** Where the projectile was when it hit, or when it expired */
+	FVector Location = FVector::ZeroVector;
+
+	/** Surface normal at the hit */
+	FVector Normal = FVector::ZeroVector;
+
+	/** Velocity right before the hit */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Physics proxy of the hit object. Resolved to a component on the game thread */
+	IPhysicsProxyBase* HitProxy = nullptr;
+
+	/** True if the projectile hit something, false if it expired */
+	bool bHit = false;
+
+	/** True if the projectile was removed from the simulation */
+	bool bRemoved = false;
+};
+
+/**
+ *  Projectiles launched by the game thread since the last physics step
+ */
+struct FAsyncProjectileInput : public Chaos::FSimCallbackInput
+{
+	TArray<FAsyncProjectileLaunch> Launches;
+
+	void Reset() { Launches.Reset(); }
+};
+
+/**
+ *  Hits and expiries produced by a physics step
+ */
+struct FAsyncProjectileOutput : public Chaos::FSimCallbackOutput
+{
+	TArray<FAsyncProjectileEvent> Events;
+
+	void Reset() { Events.Reset(); }
+};
+
+/**
+ *  Steps projectiles on the physics thread, as part of Chaos's (async) physics tick
+ *  Integration uses the same fixed step ballistics kernel as the game thread batch simulation.
+ *  Collision queries are raycasts against the physics thread's own acceleration structure,
+ *  so they never wait on or compete with game thread scene queries.
+ *  Hits are marshalled back through the callback output and resolved on the game thread.
+ */
+class FIRSTPERSON_API FAsyncProjectileSimCallback : public Chaos::TSimCallbackObject<FAsyncProjectileInput, FAsyncProjectileOutput>
+{
+	/** Per projectile physics thread state. All arrays are kept in lockstep */
+	TArray<int32> Ids;
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> Radii;
+	TArray<float> GravityZs;
+	TArray<float> Drags;
+	TArray<float> Restitutions;
+	TArray<float> Frictions;
+	TArray<float> Ages;
+	TArray<float> MaxLifetimes;
+	TArray<uint8> BouncesLeft;
+	TArray<const IPhysicsProxyBase*> IgnoredProxies;
+
+	/** Physics time not yet consumed by fixed steps */
+	float StepAccumulator = 0.0f;
+
+	/** Highest launch id added so far, so an input seen by several physics steps is only consumed once */
+	int32 LastLaunchId = INDEX_NONE;
+
+	//~Begin ISimCallbackObject interface
+	virtual void OnPreSimulate_Internal() override;
+	//~End ISimCallbackObject interface
+
+	/** Adds the launches from the game thread */
+	void ConsumeLaunches(const FAsyncProjectileInput& Input);
+
+	/** Removes a projectile from every array */
+	void RemoveProjectileAtSwap(int32 Index);
+};
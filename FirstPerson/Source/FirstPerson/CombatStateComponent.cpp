@@ -0,0 +1,210 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatStateComponent.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat State Updates"), STAT_CombatStateUpdates, STATGROUP_FirstPerson);
+
+void FCombatState::SetHealthFraction(float Fraction)
+{
+	// round up, so a combatant with any health left never reads as empty
+	Health = static_cast<uint16>(FMath::Clamp(FMath::CeilToInt(Fraction * HealthSteps), 0, static_cast<int32>(HealthSteps)));
+}
+
+void FCombatState::SetRespawnTime(double Time)
+{
+	RespawnTime = static_cast<uint32>(FMath::Max(0.0, FMath::RoundToDouble(Time * 10.0)));
+}
+
+bool FCombatState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// 12 bits of health
+	uint32 PackedHealth = Health;
+	Ar.SerializeInt(PackedHealth, HealthSteps + 1);
+
+	// death and instigator flags
+	uint8 Flags = (bDead ? 1 : 0) | (LastInstigatorId != INDEX_NONE ? 2 : 0);
+	Ar.SerializeBits(&Flags, 2);
+
+	// the respawn time only matters while dead
+	uint32 PackedRespawnTime = (Flags & 1) ? RespawnTime : 0;
+
+	if (Flags & 1)
+	{
+		Ar.SerializeIntPacked(PackedRespawnTime);
+	}
+
+	// player ids are small, so they pack into a byte or two
+	uint32 PackedInstigatorId = (Flags & 2) ? static_cast<uint32>(LastInstigatorId) : 0;
+
+	if (Flags & 2)
+	{
+		Ar.SerializeIntPacked(PackedInstigatorId);
+	}
+
+	if (Ar.IsLoading())
+	{
+		Health = static_cast<uint16>(PackedHealth);
+		bDead = (Flags & 1) != 0;
+		RespawnTime = PackedRespawnTime;
+		LastInstigatorId = (Flags & 2) ? static_cast<int32>(PackedInstigatorId) : INDEX_NONE;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+UCombatStateComponent::UCombatStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UCombatStateComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// the state is only compared after CommitState marks it dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UCombatStateComponent, State, Params);
+}
+
+void UCombatStateComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// the net driver is about to consider the component. A clean state isn't compared
+	if (!bStateDirty)
+	{
+		INC_DWORD_STAT(STAT_PushModelComparisonsSkipped);
+	}
+
+	bStateDirty = false;
+}
+
+void UCombatStateComponent::SetMaxHealth(float NewMaxHealth)
+{
+	const float HealthFraction = GetHealthFraction();
+
+	MaxHealth = FMath::Max(0.0f, NewMaxHealth);
+	Health = HealthFraction * MaxHealth;
+}
+
+void UCombatStateComponent::SetHealth(float NewHealth)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	Health = FMath::Clamp(NewHealth, 0.0f, MaxHealth);
+
+	FCombatState NewState = State;
+	NewState.SetHealthFraction(GetHealthFraction());
+
+	CommitState(NewState);
+}
+
+float UCombatStateComponent::ApplyDamage(float Damage, AController* DamageInstigator)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return Health;
+	}
+
+	Health = FMath::Clamp(Health - Damage, 0.0f, MaxHealth);
+
+	// the health and the instigator go out as one change
+	FCombatState NewState = State;
+	NewState.SetHealthFraction(GetHealthFraction());
+
+	const APlayerState* InstigatorPlayerState = DamageInstigator ? DamageInstigator->GetPlayerState<APlayerState>() : nullptr;
+	NewState.LastInstigatorId = InstigatorPlayerState ? InstigatorPlayerState->GetPlayerId() : INDEX_NONE;
+
+	CommitState(NewState);
+
+	return Health;
+}
+
+void UCombatStateComponent::SetDead(double RespawnTime)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	FCombatState NewState = State;
+	NewState.bDead = true;
+	NewState.SetRespawnTime(RespawnTime);
+
+	CommitState(NewState);
+}
+
+void UCombatStateComponent::Revive()
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	// full health, alive, and nobody to blame
+	Health = MaxHealth;
+
+	CommitState(FCombatState());
+}
+
+APlayerState* UCombatStateComponent::GetLastInstigator() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	if (!GameState || State.LastInstigatorId == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	for (APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		if (PlayerState && PlayerState->GetPlayerId() == State.LastInstigatorId)
+		{
+			return PlayerState;
+		}
+	}
+
+	return nullptr;
+}
+
+void UCombatStateComponent::CommitState(const FCombatState& NewState)
+{
+	if (NewState == State)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_CombatStateUpdates);
+
+	const FCombatState PreviousState = State;
+	State = NewState;
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(UCombatStateComponent, State, this);
+	bStateDirty = true;
+
+	OnCombatStateChanged.Broadcast(PreviousState);
+}
+
+void UCombatStateComponent::OnRep_State(const FCombatState& PreviousState)
+{
+	// clients only know the quantized health
+	Health = State.GetHealthFraction() * MaxHealth;
+
+	OnCombatStateChanged.Broadcast(PreviousState);
+}
@@ -0,0 +1,150 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CombatStateComponent.generated.h"
+
+class AController;
+class APlayerState;
+struct FCombatState;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCombatStateChanged, const FCombatState& /*PreviousState*/);
+
+/**
+ *  Health and death state of a combatant, packed into a few bytes for replication
+ */
+USTRUCT()
+struct FCombatState
+{
+	GENERATED_BODY()
+
+	/** Number of steps health is quantized to. Fits in 12 bits */
+	static constexpr uint32 HealthSteps = 4095;
+
+	/** Health as a fraction of max health, in steps */
+	uint16 Health = HealthSteps;
+
+	/** If true, the combatant is dead */
+	bool bDead = false;
+
+	/** Server time the combatant respawns at, in tenths of a second. Only sent while dead */
+	uint32 RespawnTime = 0;
+
+	/** Player id of whoever damaged the combatant last, or INDEX_NONE */
+	int32 LastInstigatorId = INDEX_NONE;
+
+	/** Returns health as a fraction of max health */
+	float GetHealthFraction() const { return static_cast<float>(Health) / HealthSteps; }
+
+	/** Sets health from a fraction of max health. Any health left stays above zero */
+	void SetHealthFraction(float Fraction);
+
+	/** Returns the respawn server time in seconds */
+	double GetRespawnTime() const { return RespawnTime * 0.1; }
+
+	/** Sets the respawn server time in seconds */
+	void SetRespawnTime(double Time);
+
+	/** Bit-packs the state: 12 bits of health, the death flag, and the respawn time and instigator when set */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FCombatState& Other) const
+	{
+		return Health == Other.Health && bDead == Other.bDead && RespawnTime == Other.RespawnTime && LastInstigatorId == Other.LastInstigatorId;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombatState> : public TStructOpsTypeTraitsBase2<FCombatState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/**
+ *  Replicated health and death state shared by every combatant
+ *  The server keeps the exact health locally and replicates a single bit-packed state struct, so clients get one
+ *  compact property and one change notification per update instead of separately replicated floats and flags.
+ *  Max health isn't replicated. Owners set it from their class defaults on every machine.
+ */
+UCLASS(ClassGroup=(FirstPerson), meta=(BlueprintSpawnableComponent))
+class FIRSTPERSON_API UCombatStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+	/** Replicated combat state */
+	UPROPERTY(ReplicatedUsing = OnRep_State)
+	FCombatState State;
+
+	/** Max health. Set by the owner */
+	float MaxHealth = 100.0f;
+
+	/** Exact health on the server. Dequantized from the replicated state on clients */
+	float Health = 100.0f;
+
+	/** If true, the state was marked dirty since the net driver last considered the component. Server only */
+	bool bStateDirty = false;
+
+public:
+
+	/** Called on every machine when the combat state changes */
+	FOnCombatStateChanged OnCombatStateChanged;
+
+	/** Constructor */
+	UCombatStateComponent();
+
+	//~Begin UActorComponent interface
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	//~End UActorComponent interface
+
+	/** Sets max health, keeping the current health fraction */
+	void SetMaxHealth(float NewMaxHealth);
+
+	/** Server only. Sets health, clamped between zero and max health */
+	void SetHealth(float NewHealth);
+
+	/** Server only. Removes health and records who dealt the damage. Returns the health left */
+	float ApplyDamage(float Damage, AController* DamageInstigator);
+
+	/** Server only. Raises the death flag and records when the combatant respawns */
+	void SetDead(double RespawnTime = 0.0);
+
+	/** Server only. Clears the death flag and restores full health */
+	void Revive();
+
+	/** Returns the current health */
+	float GetHealth() const { return Health; }
+
+	/** Returns the max health */
+	float GetMaxHealth() const { return MaxHealth; }
+
+	/** Returns the current health as a fraction of max health */
+	float GetHealthFraction() const { return MaxHealth > 0.0f ? Health / MaxHealth : 0.0f; }
+
+	/** Returns true if the combatant is dead */
+	bool IsDead() const { return State.bDead; }
+
+	/** Returns the server time the combatant respawns at, or zero if it's alive or doesn't respawn */
+	double GetRespawnTime() const { return State.GetRespawnTime(); }
+
+	/** Returns the player state of whoever damaged the combatant last, if they're still around */
+	APlayerState* GetLastInstigator() const;
+
+	/** Returns the replicated combat state */
+	const FCombatState& GetState() const { return State; }
+
+protected:
+
+	/** Updates the replicated state and notifies listeners if it changed */
+	void CommitState(const FCombatState& NewState);
+
+	/** Handles the replicated state on clients */
+	UFUNCTION()
+	void OnRep_State(const FCombatState& PreviousState);
+};
@@ -0,0 +1,137 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ExplosionSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "Engine/OverlapResult.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Components/PrimitiveComponent.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Explosions Resolve"), STAT_ExplosionsResolve, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Explosions Per Frame"), STAT_ExplosionsPerFrame, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Explosion Victims Per Frame"), STAT_ExplosionVictimsPerFrame, STATGROUP_FirstPerson);
+
+/**
+ *  Damage combined from every explosion that reached a victim in a frame
+ */
+struct FCombinedExplosionDamage
+{
+	float Damage = 0.0f;
+	AActor* DamageCauser = nullptr;
+	TSubclassOf<UDamageType> DamageType;
+};
+
+void UExplosionSubsystem::QueueExplosion(const FExplosionRequest& Request)
+{
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ExplosionOverlap), false, Request.DamageCauser.Get());
+	if (!Request.bDamageInstigator)
+	{
+		QueryParams.AddIgnoredActor(Request.Instigator.Get());
+	}
+
+	FPendingExplosion& Explosion = PendingExplosions.AddDefaulted_GetRef();
+	Explosion.Request = Request;
+	Explosion.Overlap = GetWorld()->AsyncOverlapByObjectType(Request.Center, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(Request.Radius), QueryParams);
+}
+
+void UExplosionSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ExplosionsResolve);
+
+	UWorld* World = GetWorld();
+
+	// only the server applies damage. Everyone pushes their own physics objects
+	const bool bApplyDamage = World->GetNetMode() != NM_Client;
+
+	// combined damage by victim and instigator, so kills are still credited to the right player
+	TMap<TPair<AActor*, AController*>, FCombinedExplosionDamage> Victims;
+
+	// actors already hit by the explosion being processed
+	TSet<AActor*> HitActors;
+
+	int32 NumResolved = 0;
+
+	for (int32 Index = PendingExplosions.Num() - 1; Index >= 0; --Index)
+	{
+		FOverlapDatum Datum;
+
+		if (!World->QueryOverlapData(PendingExplosions[Index].Overlap, Datum))
+		{
+			// explosions queued this frame aren't ready yet. Drop the ones whose results expired
+			if (!World->IsTraceHandleValid(PendingExplosions[Index].Overlap, true))
+			{
+				PendingExplosions.RemoveAtSwap(Index, EAllowShrinking::No);
+			}
+
+			continue;
+		}
+
+		const FExplosionRequest& Request = PendingExplosions[Index].Request;
+
+		APawn* InstigatorPawn = Request.Instigator.Get();
+		AController* InstigatorController = InstigatorPawn ? InstigatorPawn->GetController() : nullptr;
+
+		HitActors.Reset();
+
+		for (const FOverlapResult& Overlap : Datum.OutOverlaps)
+		{
+			AActor* Victim = Overlap.GetActor();
+			if (!Victim)
+			{
+				continue;
+			}
+
+			// overlaps return an actor once per overlapped component
+			bool bAlreadyHit = false;
+			HitActors.Add(Victim, &bAlreadyHit);
+
+			if (bAlreadyHit)
+			{
+				continue;
+			}
+
+			// push physics objects away from the explosion
+			UPrimitiveComponent* HitComp = Overlap.GetComponent();
+			if (HitComp && HitComp->IsSimulatingPhysics())
+			{
+				const FVector ExplosionDir = (Victim->GetActorLocation() - Request.Center).GetSafeNormal();
+				HitComp->AddImpulseAtLocation(ExplosionDir * Request.PhysicsForce, Request.Center);
+			}
+
+			// add to the victim's combined damage
+			if (bApplyDamage && Victim->IsA<ACharacter>() && (Victim != InstigatorPawn || Request.bDamageInstigator))
+			{
+				FCombinedExplosionDamage& Combined = Victims.FindOrAdd(TPair<AActor*, AController*>(Victim, InstigatorController));
+				Combined.Damage += Request.Damage;
+				Combined.DamageCauser = Request.DamageCauser.Get();
+				Combined.DamageType = Request.DamageType;
+			}
+		}
+
+		PendingExplosions.RemoveAtSwap(Index, EAllowShrinking::No);
+		++NumResolved;
+	}
+
+	// one damage event per victim
+	for (const TPair<TPair<AActor*, AController*>, FCombinedExplosionDamage>& Pair : Victims)
+	{
+		UGameplayStatics::ApplyDamage(Pair.Key.Key, Pair.Value.Damage, Pair.Key.Value, Pair.Value.DamageCauser, Pair.Value.DamageType);
+	}
+
+	SET_DWORD_STAT(STAT_ExplosionsPerFrame, NumResolved);
+	SET_DWORD_STAT(STAT_ExplosionVictimsPerFrame, Victims.Num());
+}
+
+TStatId UExplosionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UExplosionSubsystem, STATGROUP_Tickables);
+}
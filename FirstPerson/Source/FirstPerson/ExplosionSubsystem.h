@@ -0,0 +1,73 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ExplosionSubsystem.generated.h"
+
+class APawn;
+class UDamageType;
+
+/**
+ *  A radial damage and impulse request
+ */
+struct FExplosionRequest
+{
+	/** Center of the explosion */
+	FVector Center = FVector::ZeroVector;
+
+	/** Radius of the explosion */
+	float Radius = 0.0f;
+
+	/** Damage dealt to each character in range */
+	float Damage = 0.0f;
+
+	/** Impulse applied to each physics object in range, away from the center */
+	float PhysicsForce = 0.0f;
+
+	/** Type of damage dealt */
+	TSubclassOf<UDamageType> DamageType;
+
+	/** Pawn responsible for the explosion */
+	TWeakObjectPtr<APawn> Instigator;
+
+	/** Actor that exploded */
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	/** If true, the instigator is damaged by its own explosion */
+	bool bDamageInstigator = false;
+};
+
+/**
+ *  Resolves every explosion in a frame together
+ *  Each queued explosion issues an async overlap, so all of a frame's overlaps run as one batch.
+ *  Next frame the results are gathered, victims are de-duplicated per explosion with a hash set,
+ *  and each victim receives a single damage event combining every explosion that reached it.
+ */
+UCLASS()
+class FIRSTPERSON_API UExplosionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** An explosion waiting for its overlap results */
+	struct FPendingExplosion
+	{
+		FExplosionRequest Request;
+		FTraceHandle Overlap;
+	};
+
+	/** Explosions queued since the last resolve */
+	TArray<FPendingExplosion> PendingExplosions;
+
+public:
+
+	/** Queues an explosion. It's resolved with the rest of the frame's explosions */
+	void QueueExplosion(const FExplosionRequest& Request);
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+};
@@ -0,0 +1,217 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "FireCommandComponent.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Commands Sent"), STAT_FireCommandsSent, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Commands Accepted"), STAT_FireCommandsAccepted, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Commands Rejected"), STAT_FireCommandsRejected, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Commands Duplicate"), STAT_FireCommandsDuplicate, STATGROUP_FirstPerson);
+
+bool FFireCommandBatch::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// command count fits in 4 bits
+	uint32 NumCommands = Commands.Num();
+	Ar.SerializeInt(NumCommands, MaxCommands + 1);
+
+	uint16 NewestSequence = Commands.IsEmpty() ? 0 : Commands.Last().Sequence;
+	Ar << NewestSequence;
+
+	if (Ar.IsLoading())
+	{
+		Commands.SetNum(NumCommands);
+	}
+
+	for (int32 Index = 0; Index < Commands.Num(); ++Index)
+	{
+		FFireCommand& Command = Commands[Index];
+
+		Ar.SerializeIntPacked(Command.ClientTime);
+		Ar << Command.AimYaw;
+		Ar << Command.AimPitch;
+
+		// most shots aren't predicted, so the shot id is behind a bit
+		uint8 bPredicted = Command.ShotId != 0 ? 1 : 0;
+		Ar.SerializeBits(&bPredicted, 1);
+
+		if (bPredicted)
+		{
+			Ar << Command.ShotId;
+		}
+
+		if (Ar.IsLoading())
+		{
+			Command.Sequence = NewestSequence - static_cast<uint16>(Commands.Num() - 1 - Index);
+
+			if (!bPredicted)
+			{
+				Command.ShotId = 0;
+			}
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+UFireCommandComponent::UFireCommandComponent()
+{
+	// ticks only while commands wait for an acknowledgement
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UFireCommandComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// the server rejects stale commands anyway, so stop resending them
+	const double StaleTime = GetSyncedTime() - MaxCommandAge;
+
+	PendingCommands.RemoveAll([StaleTime](const FFireCommand& Command)
+	{
+		return Command.GetClientTime() < StaleTime;
+	});
+
+	if (PendingCommands.IsEmpty())
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	// keep resending until the server acknowledges
+	if (GetWorld()->GetTimeSeconds() - LastSendTime >= ResendInterval)
+	{
+		SendPendingCommands();
+	}
+}
+
+void UFireCommandComponent::SendFireCommand(const FRotator& AimRotation, uint16 ShotId)
+{
+	FFireCommand Command;
+	Command.Sequence = ++LastSentSequence;
+	Command.SetClientTime(GetSyncedTime());
+	Command.SetAimRotation(AimRotation);
+	Command.ShotId = ShotId;
+
+	INC_DWORD_STAT(STAT_FireCommandsSent);
+
+	// a listen server's own shots don't need to travel
+	if (GetOwner()->HasAuthority())
+	{
+		ProcessCommand(Command);
+		return;
+	}
+
+	// give up on the oldest commands if too many are waiting
+	PendingCommands.Add(Command);
+
+	if (PendingCommands.Num() > MaxRedundantCommands)
+	{
+		PendingCommands.RemoveAt(0, PendingCommands.Num() - MaxRedundantCommands, EAllowShrinking::No);
+	}
+
+	SendPendingCommands();
+
+	SetComponentTickEnabled(true);
+}
+
+void UFireCommandComponent::SendPendingCommands()
+{
+	FFireCommandBatch Batch;
+	Batch.Commands = PendingCommands;
+
+	ServerFireCommands(Batch);
+
+	LastSendTime = GetWorld()->GetTimeSeconds();
+}
+
+void UFireCommandComponent::ServerFireCommands_Implementation(const FFireCommandBatch& Batch)
+{
+	for (const FFireCommand& Command : Batch.Commands)
+	{
+		// resent commands we already processed
+		if (!IsNewerSequence(Command.Sequence, LastProcessedSequence))
+		{
+			INC_DWORD_STAT(STAT_FireCommandsDuplicate);
+			continue;
+		}
+
+		ProcessCommand(Command);
+	}
+
+	// acknowledge even if everything was a duplicate, in case the last ack was lost
+	ClientAckFireCommands(LastProcessedSequence);
+}
+
+void UFireCommandComponent::ClientAckFireCommands_Implementation(uint16 Sequence)
+{
+	// forget everything up to the acknowledged command
+	PendingCommands.RemoveAll([Sequence](const FFireCommand& Command)
+	{
+		return !IsNewerSequence(Command.Sequence, Sequence);
+	});
+}
+
+void UFireCommandComponent::ProcessCommand(const FFireCommand& Command)
+{
+	LastProcessedSequence = Command.Sequence;
+
+	const double Now = GetSyncedTime();
+	const double CommandTime = Command.GetClientTime();
+
+	if (ValidateCommandTime(CommandTime, Now, Budget, MinCommandInterval, TimeTolerance, MaxCommandAge, MaxBurstCommands))
+	{
+		INC_DWORD_STAT(STAT_FireCommandsAccepted);
+
+		OnFireCommandAccepted.ExecuteIfBound(Command);
+
+	} else {
+
+		INC_DWORD_STAT(STAT_FireCommandsRejected);
+
+		UE_LOG(LogFirstPerson, Verbose, TEXT("%s rejected fire command %d fired at %.3f, server time %.3f"), *GetNameSafe(GetOwner()), Command.Sequence, CommandTime, Now);
+		OnFireCommandRejected.ExecuteIfBound(Command);
+	}
+}
+
+bool UFireCommandComponent::ValidateCommandTime(double CommandTime, double Now, FFireCommandBudget& InOutBudget, float MinInterval, float Tolerance, float MaxAge, int32 MaxBurst)
+{
+	// the command must have been fired recently, and not in the future
+	if (CommandTime > Now + Tolerance || CommandTime < Now - MaxAge)
+	{
+		return false;
+	}
+
+	// the fire rate is checked on client timestamps, so commands resent together after a loss keep their spacing
+	if (InOutBudget.LastAcceptedTime >= 0.0 && CommandTime < InOutBudget.LastAcceptedTime + MinInterval - Tolerance)
+	{
+		return false;
+	}
+
+	// timestamps alone would let a client backdate a whole MaxAge of shots after idling. The receive budget refills
+	// at the fire rate and holds at most MaxBurst shots, however the commands are stamped
+	const double ReceiveBudgetTime = FMath::Max(InOutBudget.ReceiveBudgetTime, Now);
+
+	if (ReceiveBudgetTime - Now > (FMath::Max(1, MaxBurst) - 1) * MinInterval + Tolerance)
+	{
+		return false;
+	}
+
+	// charge the shot at no earlier than the budget allows, so an early shot eats into the slack for the next one
+	InOutBudget.LastAcceptedTime = InOutBudget.LastAcceptedTime >= 0.0 ? FMath::Max(CommandTime, InOutBudget.LastAcceptedTime + MinInterval) : CommandTime;
+	InOutBudget.ReceiveBudgetTime = ReceiveBudgetTime + MinInterval;
+
+	return true;
+}
+
+double UFireCommandComponent::GetSyncedTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
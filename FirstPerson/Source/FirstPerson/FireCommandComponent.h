@@ -0,0 +1,187 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "FireCommandComponent.generated.h"
+
+/**
+ *  A single fire command sent by the owning client
+ */
+struct FFireCommand
+{
+	/** Sequence number. Wraps around */
+	uint16 Sequence = 0;
+
+	/** Synced server time the client fired at, in milliseconds */
+	uint32 ClientTime = 0;
+
+	/** Aim yaw and pitch, compressed to shorts */
+	uint16 AimYaw = 0;
+	uint16 AimPitch = 0;
+
+	/** Id of the predicted projectile for this shot, or zero if it wasn't predicted */
+	uint16 ShotId = 0;
+
+	/** Returns the client time in seconds */
+	double GetClientTime() const { return ClientTime * 0.001; }
+
+	/** Sets the client time in seconds */
+	void SetClientTime(double Time) { ClientTime = static_cast<uint32>(FMath::Max(0.0, Time * 1000.0)); }
+
+	/** Returns the aim rotation */
+	FRotator GetAimRotation() const { return FRotator(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.0f); }
+
+	/** Sets the aim rotation. Roll is dropped */
+	void SetAimRotation(const FRotator& Rotation)
+	{
+		AimYaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+		AimPitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	}
+};
+
+/**
+ *  The most recent unacknowledged fire commands, sent together in one unreliable RPC
+ */
+USTRUCT()
+struct FFireCommandBatch
+{
+	GENERATED_BODY()
+
+	/** Largest number of commands in a batch */
+	static constexpr int32 MaxCommands = 8;
+
+	/** Commands with consecutive sequence numbers, oldest first */
+	TArray<FFireCommand, TInlineAllocator<MaxCommands>> Commands;
+
+	/** Sends the newest sequence number once. The others follow from the command order */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FFireCommandBatch> : public TStructOpsTypeTraitsBase2<FFireCommandBatch>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ *  Fire rate budget of a command stream, kept on the server
+ *  Commands are charged on the client's timestamps, so resent commands keep their original spacing, and on the server's
+ *  receive times, so backdated timestamps can't squeeze a burst of shots into a single update.
+ */
+struct FFireCommandBudget
+{
+	/** Client time the last accepted command was charged at */
+	double LastAcceptedTime = -1.0;
+
+	/** Server time the receive budget is spent up to */
+	double ReceiveBudgetTime = -1.0;
+};
+
+DECLARE_DELEGATE_OneParam(FFireCommandDelegate, const FFireCommand&);
+
+/**
+ *  Sends the owner's shots to the server as an unreliable, sequence-numbered command stream
+ *  Every RPC carries all the commands the server hasn't acknowledged yet, so a lost packet is covered by the next one
+ *  and a backlog never stalls the reliable buffer. The server drops commands it has already seen, rejects commands
+ *  that come faster than the fire rate or with implausible timestamps, and acknowledges the newest sequence it processed.
+ */
+UCLASS(ClassGroup=(FirstPerson), meta=(BlueprintSpawnableComponent))
+class FIRSTPERSON_API UFireCommandComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Largest number of unacknowledged commands resent with every batch. Older ones are given up on */
+	UPROPERTY(EditAnywhere, Category="Fire Commands", meta = (ClampMin = 1, ClampMax = 8))
+	int32 MaxRedundantCommands = 4;
+
+	/** Time between resends while commands wait for an acknowledgement */
+	UPROPERTY(EditAnywhere, Category="Fire Commands", meta = (ClampMin = 0, Units = "s"))
+	float ResendInterval = 0.05f;
+
+	/** Slack allowed on the fire rate and on client timestamps, to absorb time sync corrections */
+	UPROPERTY(EditAnywhere, Category="Fire Commands", meta = (ClampMin = 0, Units = "s"))
+	float TimeTolerance = 0.05f;
+
+	/** Commands fired longer ago than this are rejected as stale */
+	UPROPERTY(EditAnywhere, Category="Fire Commands", meta = (ClampMin = 0, Units = "s"))
+	float MaxCommandAge = 1.0f;
+
+	/** Largest number of commands accepted back to back on arrival, e.g. a batch resent after a loss */
+	UPROPERTY(EditAnywhere, Category="Fire Commands", meta = (ClampMin = 1, ClampMax = 8))
+	int32 MaxBurstCommands = 2;
+
+	/** Shortest time allowed between accepted commands. Set by the owner from its fire rate */
+	float MinCommandInterval = 0.0f;
+
+	/** Commands sent but not acknowledged yet, oldest first. Owning client only */
+	TArray<FFireCommand, TInlineAllocator<FFireCommandBatch::MaxCommands>> PendingCommands;
+
+	/** Sequence number of the last command sent */
+	uint16 LastSentSequence = 0;
+
+	/** Time of the last send, for resends */
+	double LastSendTime = 0.0;
+
+	/** Sequence number of the last command processed. Server only */
+	uint16 LastProcessedSequence = 0;
+
+	/** Fire rate budget. Server only */
+	FFireCommandBudget Budget;
+
+public:
+
+	/** Called on the server for every command that passes validation */
+	FFireCommandDelegate OnFireCommandAccepted;
+
+	/** Called on the server for every command that fails validation */
+	FFireCommandDelegate OnFireCommandRejected;
+
+	/** Constructor */
+	UFireCommandComponent();
+
+	//~Begin UActorComponent interface
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~End UActorComponent interface
+
+	/** Sets the shortest time allowed between accepted commands */
+	void SetMinCommandInterval(float Interval) { MinCommandInterval = Interval; }
+
+	/** Queues a fire command and sends it to the server. Processed right away when called on the server */
+	void SendFireCommand(const FRotator& AimRotation, uint16 ShotId);
+
+	/**
+	 *  Checks a command's client timestamp against the server time and the fire rate, and spends the budget if it passes
+	 *  Accepted commands advance the budget by at least MinInterval, so the tolerance is a one-off slack that a client
+	 *  can't claim again on every shot. Commands arriving together are accepted up to MaxBurst, whatever their timestamps.
+	 */
+	static bool ValidateCommandTime(double CommandTime, double Now, FFireCommandBudget& InOutBudget, float MinInterval, float Tolerance, float MaxAge, int32 MaxBurst);
+
+protected:
+
+	/** Sends every pending command */
+	void SendPendingCommands();
+
+	/** Receives a batch of commands from the owning client */
+	UFUNCTION(Server, Unreliable)
+	void ServerFireCommands(const FFireCommandBatch& Batch);
+
+	/** Tells the owning client the newest sequence the server processed */
+	UFUNCTION(Client, Unreliable)
+	void ClientAckFireCommands(uint16 Sequence);
+
+	/** De-duplicates and validates a command on the server */
+	void ProcessCommand(const FFireCommand& Command);
+
+	/** Returns true if sequence A is newer than sequence B, accounting for wrap around */
+	static bool IsNewerSequence(uint16 A, uint16 B) { return static_cast<int16>(A - B) > 0; }
+
+	/** Returns the synced server time in seconds */
+	double GetSyncedTime() const;
+};
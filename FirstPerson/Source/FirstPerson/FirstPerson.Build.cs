@@ -12,6 +12,9 @@ public class FirstPerson : ModuleRules
 			"Core",
 			"CoreUObject",
 			"Engine",
+			"NetCore",
+			"PhysicsCore",
+			"Chaos",
 			"InputCore",
 			"EnhancedInput",
 			"AIModule",
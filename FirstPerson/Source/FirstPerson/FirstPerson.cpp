@@ -5,4 +5,6 @@
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, FirstPerson, "FirstPerson" );
 
-DEFINE_LOG_CATEGORY(LogFirstPerson)
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogFirstPerson)
+
+DEFINE_STAT(STAT_PushModelComparisonsSkipped);
\ No newline at end of file
@@ -3,6 +3,13 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 
 /** Main log category used across the project */
-DECLARE_LOG_CATEGORY_EXTERN(LogFirstPerson, Log, All);
\ No newline at end of file
+DECLARE_LOG_CATEGORY_EXTERN(LogFirstPerson, Log, All);
+
+/** Stat group for the project's gameplay systems. Inspect it with "stat FirstPerson" */
+DECLARE_STATS_GROUP(TEXT("FirstPerson"), STATGROUP_FirstPerson, STATCAT_Advanced);
+
+/** Push model properties of objects that had nothing marked dirty when the net driver considered them for replication, so none were compared */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Push Model Comparisons Skipped"), STAT_PushModelComparisonsSkipped, STATGROUP_FirstPerson, FIRSTPERSON_API);
\ No newline at end of file
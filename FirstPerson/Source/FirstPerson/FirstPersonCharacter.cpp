@@ -14,13 +14,29 @@
 #include <FirstPersonPlayerController.h>
 #include "GameFramework/PlayerStart.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/GameStateBase.h"
 #include <Kismet/GameplayStatics.h>
+#include "ProjectilePoolSubsystem.h"
+#include "LagCompensationSubsystem.h"
+#include "ProjectileBatchSubsystem.h"
+#include "ProjectileFireEventComponent.h"
+#include "FireCommandComponent.h"
+#include "NetUpdateRateSubsystem.h"
+#include "ProximityTriggerSubsystem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Predictions"), STAT_ProjectilePredictions, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Prediction Corrections"), STAT_ProjectilePredictionCorrections, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Predictions Rejected"), STAT_ProjectilePredictionsRejected, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Predictions Expired"), STAT_ProjectilePredictionsExpired, STATGROUP_FirstPerson);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Projectile Prediction Error"), STAT_ProjectilePredictionError, STATGROUP_FirstPerson);
+
+/** Time after which a prediction the server never answered is dropped */
+static constexpr double ProjectilePredictionTimeout = 1.0;
+
 AFirstPersonCharacter::AFirstPersonCharacter()
 {
 	//ʼֵ
 	MaxHealth = 100.0f;
-	CurrentHealth = MaxHealth;
-	bIsKilled = false;
 	livetime = 3;
 	Tags.Add(FName("Player"));
 	// Set size for collision capsule
@@ -43,6 +59,12 @@ AFirstPersonCharacter::AFirstPersonCharacter()
 	FirstPersonCameraComponent->FirstPersonFieldOfView = 70.0f;
 	FirstPersonCameraComponent->FirstPersonScale = 0.6f;
 
+	// create the combat state component
+	CombatState = CreateDefaultSubobject<UCombatStateComponent>(TEXT("Combat State"));
+
+	// create the fire command stream
+	FireCommands = CreateDefaultSubobject<UFireCommandComponent>(TEXT("Fire Commands"));
+
 	// configure the character comps
 	GetMesh()->SetOwnerNoSee(true);
 	GetMesh()->FirstPersonPrimitiveType = EFirstPersonPrimitiveType::WorldSpaceRepresentation;
@@ -99,23 +121,84 @@ void AFirstPersonCharacter::InitializePlayer()
 	}
 }
 
-void AFirstPersonCharacter::GetLifetimeReplicatedProps(TArray <FLifetimeProperty>& OutLifetimeProps) const
+void AFirstPersonCharacter::PostInitializeComponents()
 {
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	//Ƶǰֵ
-	DOREPLIFETIME(AFirstPersonCharacter, CurrentHealth);
-	DOREPLIFETIME(AFirstPersonCharacter, bIsKilled);
+	Super::PostInitializeComponents();
+
+	// max health comes from the class defaults, so every machine sets it
+	CombatState->SetMaxHealth(MaxHealth);
+
+	// listen for health and death changes
+	CombatState->OnCombatStateChanged.AddUObject(this, &AFirstPersonCharacter::OnCombatStateChanged);
+
+	// the server only accepts shots as fast as the fire rate allows
+	FireCommands->SetMinCommandInterval(FireRate);
+	FireCommands->OnFireCommandAccepted.BindUObject(this, &AFirstPersonCharacter::OnFireCommandAccepted);
+	FireCommands->OnFireCommandRejected.BindUObject(this, &AFirstPersonCharacter::OnFireCommandRejected);
+}
+
+void AFirstPersonCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// pre-warm the projectile pool on the server so the first shots don't spawn actors
+	if (HasAuthority())
+	{
+		UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+		if (ProjectilePool && !bSimulateProjectilesInBatch)
+		{
+			ProjectilePool->PrewarmPool(ProjectileClass, ProjectilePoolSize);
+		}
+
+		// record our capsule so hitscan shots can be lag compensated against it
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+
+		// replicate faster while moving or firing near other players
+		if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+		{
+			NetUpdateRate->RegisterActor(this);
+		}
+
+		// set off pickups and treasure while a player controls us
+		if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+		{
+			ProximityTriggers->RegisterPawn(this);
+		}
+	}
 }
 
 void AFirstPersonCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+	{
+		NetUpdateRate->UnregisterActor(this);
+	}
+
+	if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+	{
+		ProximityTriggers->UnregisterPawn(this);
+	}
+
 	// ʱ
 	GetWorld()->GetTimerManager().ClearTimer(livetimer);
 	GetWorld()->GetTimerManager().ClearTimer(FiringTimer);
 }
 
+float AFirstPersonCharacter::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	return UNetUpdateRateSubsystem::ScaleNetPriority(this, ViewPos, Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth));
+}
+
 void AFirstPersonCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	// Set up action bindings
@@ -148,10 +231,10 @@ void AFirstPersonCharacter::Healthlog()
 	//ͻضĹ
 	if (IsLocallyControlled())
 	{
-		FString healthMessage = FString::Printf(TEXT("You now have %f health remaining."), CurrentHealth);
+		FString healthMessage = FString::Printf(TEXT("You now have %f health remaining."), GetCurrentHealth());
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
 
-		if (CurrentHealth <= 0)
+		if (GetCurrentHealth() <= 0)
 		{
 			FString deathMessage = FString::Printf(TEXT("You have been killed."));
 			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, deathMessage);
@@ -161,7 +244,7 @@ void AFirstPersonCharacter::Healthlog()
 	//ضĹ
 	if (GetLocalRole() == ROLE_Authority)
 	{
-		FString healthMessage = FString::Printf(TEXT("%s now has %f health remaining."), *GetFName().ToString(), CurrentHealth);
+		FString healthMessage = FString::Printf(TEXT("%s now has %f health remaining."), *GetFName().ToString(), GetCurrentHealth());
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
 	}
 
@@ -248,7 +331,11 @@ void AFirstPersonCharacter::DoFireStart()
 			FireRotation = GetActorRotation();
 		}
 
-		HandleFire(FireRotation);
+		// show the shot right away instead of waiting for the server's projectile
+		const uint16 ShotId = PredictShot(FireRotation);
+
+		// sent unreliably and resent until the server acknowledges it
+		FireCommands->SendFireCommand(FireRotation, ShotId);
 	}
 }
 
@@ -258,7 +345,127 @@ void AFirstPersonCharacter::DoFireEnd()
 	bIsFiringWeapon = false;
 }
 
-void AFirstPersonCharacter::HandleFire_Implementation(const FRotator& FireRotation)
+uint16 AFirstPersonCharacter::PredictShot(const FRotator& FireRotation)
+{
+	// only remote owning clients predict. Shots without a replicated projectile actor have nothing to hand over to
+	if (!bPredictProjectiles || HasAuthority() || !IsLocallyControlled() || !ProjectileClass || bSimulateProjectilesInBatch || FindComponentByClass<UProjectileFireEventComponent>())
+	{
+		return 0;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// drop the predictions the server never answered
+	for (TMap<uint16, FPredictedProjectile>::TIterator It = PredictedProjectiles.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().FireTime > ProjectilePredictionTimeout)
+		{
+			AFirstPersonProjectile* Stale = It.Value().Projectile.Get();
+			if (Stale && Stale->GetShotId() == It.Key())
+			{
+				UProjectilePoolSubsystem::ReleaseOrDestroy(Stale);
+			}
+
+			INC_DWORD_STAT(STAT_ProjectilePredictionsExpired);
+			It.RemoveCurrent();
+		}
+	}
+
+	const FTransform spawnTransform = GetProjectileSpawnTransform(FireRotation);
+
+	AFirstPersonProjectile* Projectile = nullptr;
+
+	if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		Projectile = ProjectilePool->AcquireProjectile<AFirstPersonProjectile>(ProjectileClass, spawnTransform, this, this);
+	}
+	else
+	{
+		FActorSpawnParameters spawnParameters;
+		spawnParameters.Instigator = this;
+		spawnParameters.Owner = this;
+
+		Projectile = GetWorld()->SpawnActor<AFirstPersonProjectile>(ProjectileClass, spawnTransform, spawnParameters);
+	}
+
+	if (!Projectile)
+	{
+		return 0;
+	}
+
+	// zero means the shot wasn't predicted
+	if (++LastShotId == 0)
+	{
+		++LastShotId;
+	}
+
+	Projectile->SetShotId(LastShotId);
+
+	FPredictedProjectile& Prediction = PredictedProjectiles.Add(LastShotId);
+	Prediction.Projectile = Projectile;
+	Prediction.FireTime = Now;
+
+	INC_DWORD_STAT(STAT_ProjectilePredictions);
+
+	return LastShotId;
+}
+
+void AFirstPersonCharacter::ReconcilePredictedProjectile(AFirstPersonProjectile* AuthoritativeProjectile)
+{
+	const uint16 ShotId = AuthoritativeProjectile->GetShotId();
+
+	FPredictedProjectile Prediction;
+	if (!PredictedProjectiles.RemoveAndCopyValue(ShotId, Prediction))
+	{
+		return;
+	}
+
+	// the prediction already hit something. The server's projectile will resolve the real hit
+	AFirstPersonProjectile* Predicted = Prediction.Projectile.Get();
+	if (!Predicted || Predicted->GetShotId() != ShotId)
+	{
+		return;
+	}
+
+	// where the server's projectile would be had it been fired when we pulled the trigger
+	const float PredictedAge = static_cast<float>(GetWorld()->GetTimeSeconds() - Prediction.FireTime);
+	const FVector Expected = AuthoritativeProjectile->GetActorLocation() + AuthoritativeProjectile->GetVelocity() * PredictedAge;
+	const float PredictionError = FVector::Dist(Predicted->GetActorLocation(), Expected);
+
+	SET_FLOAT_STAT(STAT_ProjectilePredictionError, PredictionError);
+
+	// keep the predicted position if it's close enough, so the shot doesn't visibly jump
+	FVector HandoverLocation = Predicted->GetActorLocation();
+
+	if (PredictionError > PredictionCorrectionDistance)
+	{
+		HandoverLocation = Expected;
+		INC_DWORD_STAT(STAT_ProjectilePredictionCorrections);
+	}
+
+	// the server's projectile takes over. Sweep so it still hits anything on the way
+	AuthoritativeProjectile->SetActorLocation(HandoverLocation, true);
+
+	UProjectilePoolSubsystem::ReleaseOrDestroy(Predicted);
+}
+
+void AFirstPersonCharacter::ClientRejectShot_Implementation(uint16 ShotId)
+{
+	INC_DWORD_STAT(STAT_ProjectilePredictionsRejected);
+
+	// kill the prediction if it's still flying
+	FPredictedProjectile Prediction;
+	if (PredictedProjectiles.RemoveAndCopyValue(ShotId, Prediction))
+	{
+		AFirstPersonProjectile* Predicted = Prediction.Projectile.Get();
+		if (Predicted && Predicted->GetShotId() == ShotId)
+		{
+			UProjectilePoolSubsystem::ReleaseOrDestroy(Predicted);
+		}
+	}
+}
+
+FTransform AFirstPersonCharacter::GetProjectileSpawnTransform(const FRotator& FireRotation) const
 {
 	// ʹôӿͻ˴ת
 	FVector spawnLocation;
@@ -274,11 +481,97 @@ void AFirstPersonCharacter::HandleFire_Implementation(const FRotator& FireRotati
 	// ǰƫ
 	spawnLocation += FireRotation.Vector() * 150.0f;
 
-	FActorSpawnParameters spawnParameters;
-	spawnParameters.Instigator = this;
-	spawnParameters.Owner = this;
+	return FTransform(FireRotation, spawnLocation);
+}
 
-	GetWorld()->SpawnActor<AFirstPersonProjectile>(ProjectileClass, spawnLocation, FireRotation, spawnParameters);
+void AFirstPersonCharacter::OnFireCommandAccepted(const FFireCommand& Command)
+{
+	HandleFire(Command.GetAimRotation(), Command.ShotId);
+}
+
+void AFirstPersonCharacter::OnFireCommandRejected(const FFireCommand& Command)
+{
+	if (Command.ShotId != 0)
+	{
+		ClientRejectShot(Command.ShotId);
+	}
+}
+
+void AFirstPersonCharacter::HandleFire(const FRotator& FireRotation, uint16 ShotId)
+{
+	// dead shooters can't fire
+	if (IsKilled() || !ProjectileClass)
+	{
+		if (ShotId != 0)
+		{
+			ClientRejectShot(ShotId);
+		}
+
+		return;
+	}
+
+	// firing characters replicate at their full rate
+	if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+	{
+		NetUpdateRate->NotifyActivity(this);
+	}
+
+	const FTransform spawnTransform = GetProjectileSpawnTransform(FireRotation);
+
+	AFirstPersonProjectile* Projectile = nullptr;
+
+	UProjectileBatchSubsystem* ProjectileBatch = GetWorld()->GetSubsystem<UProjectileBatchSubsystem>();
+	UProjectileFireEventComponent* FireEvents = FindComponentByClass<UProjectileFireEventComponent>();
+
+	// batched shots have no actor to replicate. Networked games show them on remote clients through fire events,
+	// and keep the replicated projectile if there's no way to send them
+	const bool bCanSimulateInBatch = bSimulateProjectilesInBatch && ProjectileBatch
+		&& (GetNetMode() == NM_Standalone || (FireEvents && FireEvents->CanFireProjectile(ProjectileClass)));
+
+	if (bCanSimulateInBatch)
+	{
+		// simulate the shot without an actor
+		FBatchedProjectileParams Params;
+		ProjectileClass->GetDefaultObject<AFirstPersonProjectile>()->GetBatchedProjectileParams(Params);
+
+		ProjectileBatch->LaunchProjectile(Params, spawnTransform, this);
+
+		// let remote clients play a cosmetic copy
+		if (FireEvents)
+		{
+			FireEvents->RecordFireEvent(ProjectileClass, spawnTransform);
+		}
+	}
+	else if (FireEvents && FireEvents->FireProjectile(ProjectileClass, spawnTransform, this))
+	{
+		// the shot was sent to clients as a fire event instead of a replicated projectile
+	}
+	else if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		// take a projectile from the pool
+		Projectile = ProjectilePool->AcquireProjectile<AFirstPersonProjectile>(ProjectileClass, spawnTransform, this, this);
+	}
+	else
+	{
+		FActorSpawnParameters spawnParameters;
+		spawnParameters.Instigator = this;
+		spawnParameters.Owner = this;
+
+		Projectile = GetWorld()->SpawnActor<AFirstPersonProjectile>(ProjectileClass, spawnTransform, spawnParameters);
+	}
+
+	// tag the projectile so the owning client can hand its prediction over, or kill it if there's nothing to hand over to
+	if (ShotId != 0)
+	{
+		if (Projectile)
+		{
+			Projectile->SetShotId(ShotId);
+		}
+		else
+		{
+			ClientRejectShot(ShotId);
+		}
+	}
 }
 
 void AFirstPersonCharacter::DisablePlayerInput()
@@ -304,9 +597,11 @@ void AFirstPersonCharacter::EnablePlayerInput()
 void AFirstPersonCharacter::Die()
 {
 	// ִ
-	if (GetLocalRole() != ROLE_Authority || bIsKilled) return;
+	if (GetLocalRole() != ROLE_Authority || IsKilled()) return;
 
-	bIsKilled = true;
+	// clients can count down to the replicated respawn time
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	CombatState->SetDead(GameState ? GameState->GetServerWorldTimeSeconds() + livetime : 0.0);
 
 	GetCharacterMovement()->StopMovementImmediately();
 	DisablePlayerInput();
@@ -355,8 +650,7 @@ void AFirstPersonCharacter::Respawn()
 	// ִ
 	if (GetLocalRole() != ROLE_Authority) return;
 
-	CurrentHealth = MaxHealth;
-	bIsKilled = false;
+	CombatState->Revive();
 
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 
@@ -399,23 +693,27 @@ void AFirstPersonCharacter::Respawn()
 			}
 		}
 	}
+	//Healthlog();
+}
 
-	if (APlayerController* PC = Cast<APlayerController>(GetController()))
+void AFirstPersonCharacter::OnCombatStateChanged(const FCombatState& PreviousState)
+{
+	// update the HUD on the owning machine
+	if (IsLocallyControlled() && PreviousState.Health != CombatState->GetState().Health)
 	{
-		// Controller½ֵUI
-		if (AFirstPersonPlayerController* FPPC = Cast<AFirstPersonPlayerController>(PC))
+		if (AFirstPersonPlayerController* FirstPersonPC = GetController<AFirstPersonPlayerController>())
 		{
-			// Ѫ
-			FPPC->UpdateHealthOnHUD(CurrentHealth, MaxHealth);
+			FirstPersonPC->UpdateHealthOnHUD(GetCurrentHealth(), GetMaxHealth());
 		}
 	}
-	//Healthlog();
-}
 
-// 8.  OnRep_IsKilled  OnRep_CurrentHealth 棩
-void AFirstPersonCharacter::OnRep_IsKilled()
-{
-	if (bIsKilled)
+	// the server plays death and respawn from Die and Respawn
+	if (HasAuthority() || PreviousState.bDead == IsKilled())
+	{
+		return;
+	}
+
+	if (IsKilled())
 	{
 		// ͻ
 		GetCharacterMovement()->StopMovementImmediately();
@@ -459,38 +757,14 @@ void AFirstPersonCharacter::OnRep_IsKilled()
 	}
 }
 
-void AFirstPersonCharacter::OnRep_CurrentHealth()
-{
-	if (IsLocallyControlled())
-	{
-		if (APlayerController* PC = GetController<APlayerController>())
-		{
-			if (AFirstPersonPlayerController* FirstPersonPC = Cast<AFirstPersonPlayerController>(PC))
-			{
-				FirstPersonPC->UpdateHealthOnHUD(CurrentHealth, MaxHealth);
-			}
-		}
-	}
-	//Healthlog();
-}
-
 void AFirstPersonCharacter::SetCurrentHealth(float healthValue)
 {
 	if (GetLocalRole() == ROLE_Authority)
 	{
-		CurrentHealth = FMath::Clamp(healthValue, 0.f, MaxHealth);
-		if (IsLocallyControlled())
-		{
-			if (APlayerController* PC = GetController<APlayerController>())
-			{
-				if (AFirstPersonPlayerController* FirstPersonPC = Cast<AFirstPersonPlayerController>(PC))
-				{
-					FirstPersonPC->UpdateHealthOnHUD(CurrentHealth, MaxHealth);
-				}
-			}
-		}
+		// the HUD is updated from OnCombatStateChanged
+		CombatState->SetHealth(healthValue);
 		//Healthlog();
-		if (CurrentHealth <= 0.0f && !bIsKilled)
+		if (GetCurrentHealth() <= 0.0f && !IsKilled())
 		{
 			Die();
 		}
@@ -498,8 +772,12 @@ void AFirstPersonCharacter::SetCurrentHealth(float healthValue)
 }
 float AFirstPersonCharacter::TakeDamage(float DamageTaken, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	if (bIsKilled) return 0.0f;
-	float damageApplied = CurrentHealth - DamageTaken;
-	SetCurrentHealth(damageApplied);
+	if (IsKilled()) return 0.0f;
+	// the damage and its instigator replicate as a single combat state change
+	float damageApplied = CombatState->ApplyDamage(DamageTaken, EventInstigator);
+	if (damageApplied <= 0.0f)
+	{
+		Die();
+	}
 	return damageApplied;
 }
@@ -6,6 +6,7 @@
 #include "GameFramework/Character.h"
 #include "Logging/LogMacros.h"
 #include "FirstPersonProjectile.h"
+#include "CombatStateComponent.h"
 #include "FirstPersonCharacter.generated.h"
 
 
@@ -13,10 +14,24 @@ class UInputComponent;
 class USkeletalMeshComponent;
 class UCameraComponent;
 class UInputAction;
+class UFireCommandComponent;
 struct FInputActionValue;
+struct FFireCommand;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateCharacter, Log, All);
 
+/**
+ *  A projectile spawned by the owning client before the server confirmed the shot
+ */
+struct FPredictedProjectile
+{
+	/** Local stand-in for the authoritative projectile */
+	TWeakObjectPtr<AFirstPersonProjectile> Projectile;
+
+	/** Local time the shot was fired at */
+	double FireTime = 0.0;
+};
+
 /**
  *  A basic first person character
  */
@@ -33,6 +48,14 @@ class AFirstPersonCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components", meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* FirstPersonCameraComponent;
 
+	/** Replicated health and death state */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components", meta = (AllowPrivateAccess = "true"))
+	UCombatStateComponent* CombatState;
+
+	/** Unreliable fire command stream to the server */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components", meta = (AllowPrivateAccess = "true"))
+	UFireCommandComponent* FireCommands;
+
 protected:
 
 	/** Jump Input Action */
@@ -58,42 +81,26 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Health")
 	float MaxHealth;
 
-	/** ҵĵǰֵ0ͱʾ*/
-	UPROPERTY(ReplicatedUsing = OnRep_CurrentHealth)
-	float CurrentHealth;
-
-	/** Ƿ񱻻ɱ */
-	UPROPERTY(ReplicatedUsing = OnRep_IsKilled)
-	bool bIsKilled = false;
-
 	/** ʱ䣨룩 */
 	UPROPERTY(EditDefaultsOnly, Category = "Respawn")
 	float livetime = 5.0f;
 
-	/** RepNotifyͬԵǰֵĸġ*/
-	UFUNCTION()
-	void OnRep_CurrentHealth();
-	/** RepNotifyͬɱ״̬ */
-	UFUNCTION()
-	void OnRep_IsKilled();	
 public:
 	AFirstPersonCharacter();
 	void PossessedBy(AController* NewController);
 	void InitializePlayer();
-	/** Ը */
-	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	/** ֵȡֵ*/
 	UFUNCTION(BlueprintPure, Category = "Health")
-	FORCEINLINE float GetMaxHealth() const { return MaxHealth; }
+	FORCEINLINE float GetMaxHealth() const { return CombatState->GetMaxHealth(); }
 
 	/** ǰֵȡֵ*/
 	UFUNCTION(BlueprintPure, Category = "Health")
-	FORCEINLINE float GetCurrentHealth() const { return CurrentHealth; }
+	FORCEINLINE float GetCurrentHealth() const { return CombatState->GetHealth(); }
 
 /** Ƿ񱻻ɱ */
 	UFUNCTION(BlueprintPure, Category = "Health")
-	FORCEINLINE bool IsKilled() const { return bIsKilled; }
+	FORCEINLINE bool IsKilled() const { return CombatState->IsDead(); }
 
 	/** ǰֵĴֵֵķΧ޶0MaxHealth֮䣬OnHealthUpdateڷϵá*/
 	UFUNCTION(BlueprintCallable, Category = "Health")
@@ -115,6 +122,9 @@ protected:
 	/**  */
 	void Respawn();
 
+	/** Updates the HUD and plays death and respawn on clients when the combat state changes */
+	virtual void OnCombatStateChanged(const FCombatState& PreviousState);
+
 	/** ȫؽ */
 	void DisablePlayerInput();
 
@@ -155,6 +165,28 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Gameplay|Projectile")
 	TSubclassOf<class AFirstPersonProjectile> ProjectileClass;
 
+	/** Number of projectiles to pre-warm in the projectile pool when play begins */
+	UPROPERTY(EditDefaultsOnly, Category = "Gameplay|Projectile", meta = (ClampMin = 0))
+	int32 ProjectilePoolSize = 8;
+
+	/** If true, shots are simulated by the projectile batch subsystem instead of spawning projectile actors. Networked games also need a fire event component that can send the projectile class */
+	UPROPERTY(EditDefaultsOnly, Category = "Gameplay|Projectile")
+	bool bSimulateProjectilesInBatch = false;
+
+	/** If true, the owning client spawns a local projectile as soon as it fires, and hands it over to the server's projectile when that arrives */
+	UPROPERTY(EditDefaultsOnly, Category = "Gameplay|Projectile")
+	bool bPredictProjectiles = true;
+
+	/** Predicted projectiles further than this from the authoritative trajectory are snapped onto it on handover */
+	UPROPERTY(EditDefaultsOnly, Category = "Gameplay|Projectile", meta = (ClampMin = 0, Units = "cm"))
+	float PredictionCorrectionDistance = 100.0f;
+
+	/** Predicted projectiles waiting for the server, by shot id */
+	TMap<uint16, FPredictedProjectile> PredictedProjectiles;
+
+	/** Id of the last predicted shot. Zero is reserved for shots that weren't predicted */
+	uint16 LastShotId = 0;
+
 	/** ֮ӳ٣λΪ롣ڿƲԷٶȣɷֹ½SpawnProjectileֱӰ롣*/
 	UPROPERTY(EditDefaultsOnly, Category = "Input")
 	float FireRate;
@@ -165,8 +197,26 @@ protected:
 
 
 	/** Ͷķ*/
-	UFUNCTION(Server, Reliable)
-	void HandleFire(const FRotator& FireRotation);
+	void HandleFire(const FRotator& FireRotation, uint16 ShotId);
+
+	/** Fires a shot for a fire command the server accepted */
+	void OnFireCommandAccepted(const FFireCommand& Command);
+
+	/** Kills the prediction of a fire command the server rejected */
+	void OnFireCommandRejected(const FFireCommand& Command);
+
+	/**
+	 *  Tells the owning client the server didn't fire a predicted shot
+	 *  Unreliable so a spammed rejection can't flood the reliable buffer. A lost one leaves the prediction to time out
+	 */
+	UFUNCTION(Client, Unreliable)
+	void ClientRejectShot(uint16 ShotId);
+
+	/** Spawns the owning client's predicted projectile. Returns the shot id, or zero if the shot isn't predicted */
+	uint16 PredictShot(const FRotator& FireRotation);
+
+	/** Returns the projectile spawn transform for the given aim */
+	FTransform GetProjectileSpawnTransform(const FRotator& FireRotation) const;
 
 	/** ʱṩɼʱڵӳ١*/
 	FTimerHandle FiringTimer;
@@ -176,8 +226,17 @@ protected:
 	/** Set up input action bindings */
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
 
+	virtual void PostInitializeComponents() override;
+
+	virtual void BeginPlay() override;
+
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+public:
+
+	/** Scales the net priority by activity and distance from the connection's view */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
 	protected:
 		/** ײļ */
 		UPROPERTY(EditAnywhere, Category = "Damage")
@@ -190,4 +249,10 @@ public:
 	/** Returns first person camera component **/
 	UCameraComponent* GetFirstPersonCameraComponent() const { return FirstPersonCameraComponent; }
 
+	/** Returns the combat state component **/
+	UCombatStateComponent* GetCombatState() const { return CombatState; }
+
+	/** Replaces the predicted projectile for a shot with the server's. Called on the owning client */
+	void ReconcilePredictedProjectile(AFirstPersonProjectile* AuthoritativeProjectile);
+
 };
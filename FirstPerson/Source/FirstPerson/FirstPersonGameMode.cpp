@@ -62,9 +62,9 @@ void AFirstPersonGameMode::PostLogin(APlayerController* NewPlayer)
 
         {
 
-            MyGameState->RemainingTime = GameDuration;
+            MyGameState->SetRemainingTime(GameDuration);
 
-            MyGameState->bGameEnded = false;
+            MyGameState->SetGameEnded(false);
 
             bGameStarted = true;
 
@@ -86,12 +86,13 @@ void AFirstPersonGameMode::Tick(float DeltaSeconds)
         {
             if (!MyGameState->bGameEnded && MyGameState->RemainingTime > 0.0f && bGameStarted)
             {
-                MyGameState->RemainingTime -= DeltaSeconds;
+                // only dirtied for replication when the whole second changes
+                MyGameState->SetRemainingTime(MyGameState->RemainingTime - DeltaSeconds);
                 UE_LOG(LogTemp, Log, TEXT("RemainingTime: %.2f"), MyGameState->RemainingTime); // 
                 if (MyGameState->RemainingTime <= 0.0f)
                 {
-                    MyGameState->RemainingTime = 0.0f;
-                    MyGameState->bGameEnded = true;
+                    MyGameState->SetRemainingTime(0.0f);
+                    MyGameState->SetGameEnded(true);
                     UE_LOG(LogTemp, Warning, TEXT("Game time is up!")); // ڻˣ
                 }
             }
@@ -9,6 +9,14 @@
 #include "Particles/ParticleSystem.h"
 #include "Kismet/GameplayStatics.h"
 #include "UObject/ConstructorHelpers.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileBatchSubsystem.h"
+#include "ProjectileBallistics.h"
+#include "ImpactEffectSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+#include "FirstPersonCharacter.h"
+#include "NetUpdateRateSubsystem.h"
 // Sets default values
 AFirstPersonProjectile::AFirstPersonProjectile()
 {
@@ -68,10 +76,36 @@ AFirstPersonProjectile::AFirstPersonProjectile()
 	ProjectileMovementComponent->bRotationFollowsVelocity = true;
 	ProjectileMovementComponent->ProjectileGravityScale = 0.0f;
 
+	// sub-step so the small, fast sphere doesn't skip through thin geometry and flies the same at any frame rate
+	ProjectileMovementComponent->bForceSubStepping = true;
+	ProjectileMovementComponent->MaxSimulationTimeStep = FProjectileBallistics::FixedStep;
+	ProjectileMovementComponent->MaxSimulationIterations = FProjectileBallistics::MaxStepsPerFrame;
+
 	DamageType = UDamageType::StaticClass();
 	Damage = 50.0f;
 }
 
+void AFirstPersonProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AFirstPersonProjectile, PoolLaunch);
+	DOREPLIFETIME_CONDITION(AFirstPersonProjectile, ShotId, COND_OwnerOnly);
+}
+
+void AFirstPersonProjectile::GetBatchedProjectileParams(FBatchedProjectileParams& OutParams) const
+{
+	OutParams.Speed = ProjectileMovementComponent->InitialSpeed;
+	OutParams.Radius = SphereComponent->GetScaledSphereRadius();
+	OutParams.GravityScale = ProjectileMovementComponent->ProjectileGravityScale;
+	OutParams.Restitution = ProjectileMovementComponent->Bounciness;
+	OutParams.Friction = ProjectileMovementComponent->Friction;
+	OutParams.Damage = Damage;
+	OutParams.DamageType = DamageType;
+
+	OutParams.MaxLifetime = MaxFlightTime;
+}
+
 // Called when the game starts or when spawned
 void AFirstPersonProjectile::BeginPlay()
 {
@@ -80,11 +114,30 @@ void AFirstPersonProjectile::BeginPlay()
 	{
 		SphereComponent->IgnoreActorWhenMoving(GetInstigator(), true);
 	}
+
+	// adapt the update rate to the projectile's flight and distance from players
+	if (UNetUpdateRateSubsystem* NetUpdateRate = HasAuthority() ? GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>() : nullptr)
+	{
+		NetUpdateRate->RegisterActor(this);
+	}
 }
-void AFirstPersonProjectile::Destroyed()
+void AFirstPersonProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	FVector spawnLocation = GetActorLocation();
-	UGameplayStatics::SpawnEmitterAtLocation(this, ExplosionEffect, spawnLocation, FRotator::ZeroRotator, true, EPSCPoolMethod::AutoRelease);
+	Super::EndPlay(EndPlayReason);
+
+	if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+	{
+		NetUpdateRate->UnregisterActor(this);
+	}
+}
+float AFirstPersonProjectile::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	return UNetUpdateRateSubsystem::ScaleNetPriority(this, ViewPos, Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth));
+}
+void AFirstPersonProjectile::MulticastImpactEffect_Implementation(const FVector_NetQuantize& ImpactLocation)
+{
+	// let the dispatcher batch, cull and cap the effect. Dedicated servers skip it entirely
+	UImpactEffectSubsystem::QueueImpact(this, ExplosionEffect, ImpactLocation);
 }
 void AFirstPersonProjectile::OnProjectileImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
@@ -97,10 +150,17 @@ void AFirstPersonProjectile::OnProjectileImpact(UPrimitiveComponent* HitComponen
 			return;
 		}
 
-		UGameplayStatics::ApplyPointDamage(OtherActor, Damage, NormalImpulse, Hit,
-			GetInstigator() ? GetInstigator()->Controller : nullptr, this, DamageType);
+		// only the server applies damage. Clients may be simulating a cosmetic copy from a fire event
+		if (GetNetMode() != NM_Client)
+		{
+			UGameplayStatics::ApplyPointDamage(OtherActor, Damage, NormalImpulse, Hit,
+				GetInstigator() ? GetInstigator()->Controller : nullptr, this, DamageType);
+		}
 	}
-	Destroy();
+	MulticastImpactEffect(GetActorLocation());
+
+	// hand the projectile back to the pool instead of destroying it
+	UProjectilePoolSubsystem::ReleaseOrDestroy(this);
 }
 // Called every frame
 void AFirstPersonProjectile::Tick(float DeltaTime)
@@ -109,3 +169,93 @@ void AFirstPersonProjectile::Tick(float DeltaTime)
 
 }
 
+void AFirstPersonProjectile::OnAcquiredFromPool()
+{
+	// wake up replication so clients see the projectile again
+	SetNetDormancy(DORM_Awake);
+
+	ResetForLaunch();
+
+	// let clients relaunch their copy
+	PoolLaunch.Location = GetActorLocation();
+	PoolLaunch.Direction = GetActorForwardVector();
+	++PoolLaunch.Generation;
+
+	ForceNetUpdate();
+}
+
+void AFirstPersonProjectile::OnRep_PoolLaunch()
+{
+	// move our copy to the new launch. Movement isn't replicated, so we simulate the flight locally
+	SetActorLocationAndRotation(PoolLaunch.Location, PoolLaunch.Direction.Rotation(), false, nullptr, ETeleportType::ResetPhysics);
+
+	// the projectile may be sitting in the pool when it first becomes relevant to us
+	if (IsHidden())
+	{
+		return;
+	}
+
+	ResetForLaunch();
+}
+
+void AFirstPersonProjectile::OnRep_ShotId()
+{
+	// wait until the launch has been applied too, so the handover starts from the right place
+	if (ShotId != 0)
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &AFirstPersonProjectile::HandOverPrediction);
+	}
+}
+
+void AFirstPersonProjectile::HandOverPrediction()
+{
+	if (AFirstPersonCharacter* Shooter = Cast<AFirstPersonCharacter>(GetOwner()))
+	{
+		Shooter->ReconcilePredictedProjectile(this);
+	}
+}
+
+void AFirstPersonProjectile::ResetForLaunch()
+{
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+
+	// ignore the new shooter instead of the previous one
+	SphereComponent->ClearMoveIgnoreActors();
+	if (GetInstigator())
+	{
+		SphereComponent->IgnoreActorWhenMoving(GetInstigator(), true);
+	}
+
+	// restart movement along the new facing
+	ProjectileMovementComponent->SetUpdatedComponent(SphereComponent);
+	ProjectileMovementComponent->Velocity = GetActorForwardVector() * ProjectileMovementComponent->InitialSpeed;
+	ProjectileMovementComponent->UpdateComponentVelocity();
+	ProjectileMovementComponent->SetComponentTickEnabled(true);
+}
+
+void AFirstPersonProjectile::OnReturnedToPool()
+{
+	// stop in place
+	ProjectileMovementComponent->StopMovementImmediately();
+	ProjectileMovementComponent->SetComponentTickEnabled(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	// the next shot gets its own id
+	ShotId = 0;
+
+	// stop replicating once the hidden state has been sent
+	SetNetDormancy(DORM_DormantAll);
+}
+
+FProjectileFlightLimits AFirstPersonProjectile::GetFlightLimits() const
+{
+	FProjectileFlightLimits Limits;
+	Limits.MaxFlightTime = MaxFlightTime;
+	Limits.MaxFlightRange = MaxFlightRange;
+	return Limits;
+}
@@ -4,16 +4,34 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PooledProjectile.h"
 #include "FirstPersonProjectile.generated.h"
 
+struct FBatchedProjectileParams;
+
 UCLASS()
-class FIRSTPERSON_API AFirstPersonProjectile : public AActor
+class FIRSTPERSON_API AFirstPersonProjectile : public AActor, public IPooledProjectile
 {
 	GENERATED_BODY()
 	
 public:	
 	// Sets default values for this actor's properties
 	AFirstPersonProjectile();
+
+    // Fills the batch simulation parameters from this projectile's settings. Usually called on the class defaults
+    void GetBatchedProjectileParams(FBatchedProjectileParams& OutParams) const;
+
+    // Replicated properties
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+    // Tags this projectile with the id of the client predicted shot it belongs to
+    void SetShotId(uint16 NewShotId) { ShotId = NewShotId; }
+
+    // Returns the id of the predicted shot this projectile belongs to. Zero if the shot wasn't predicted
+    uint16 GetShotId() const { return ShotId; }
+
+    // Scales the net priority by activity and distance from the viewer
+    virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
 public:
     // ڲײ
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
@@ -38,15 +56,57 @@ public:
     //Ͷɵ˺
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Damage")
     float Damage;
+
+    // Max time in flight before the lifetime manager takes the projectile back
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0, Units = "s"))
+    float MaxFlightTime = 5.0f;
+
+    // Max distance from the muzzle before the lifetime manager takes the projectile back
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0, Units = "cm"))
+    float MaxFlightRange = 15000.0f;
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
-    virtual void Destroyed() override;
+
+    // Stops adapting the update rate
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     UFUNCTION(Category = "Projectile")
     void OnProjectileImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+    // Plays the explosion effect on every machine. Pooled projectiles are never destroyed, so this replaces Destroyed() for effects
+    UFUNCTION(NetMulticast, Unreliable)
+    void MulticastImpactEffect(const FVector_NetQuantize& ImpactLocation);
+
+    // Updated every time the projectile is taken out of the pool, so clients can relaunch their copy
+    UPROPERTY(ReplicatedUsing = OnRep_PoolLaunch)
+    FPooledProjectileLaunch PoolLaunch;
+
+    // Relaunches the client copy of the projectile after the server reused it
+    UFUNCTION()
+    void OnRep_PoolLaunch();
+
+    // Shows the projectile, re-enables collision and restarts movement along the current facing
+    void ResetForLaunch();
+
+    // Id of the client predicted shot this projectile belongs to. Only the shooter needs it
+    UPROPERTY(ReplicatedUsing = OnRep_ShotId)
+    uint16 ShotId = 0;
+
+    // Schedules the handover of the owning client's predicted projectile
+    UFUNCTION()
+    void OnRep_ShotId();
+
+    // Lets the shooter replace its predicted projectile with this one
+    void HandOverPrediction();
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+    //~Begin IPooledProjectile interface
+    virtual void OnAcquiredFromPool() override;
+    virtual void OnReturnedToPool() override;
+    virtual FProjectileFlightLimits GetFlightLimits() const override;
+    //~End IPooledProjectile interface
+
 };
@@ -0,0 +1,187 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ImpactEffectSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Impact Effects Dispatch"), STAT_ImpactEffectsDispatch, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Queued"), STAT_ImpactEffectsQueued, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Culled"), STAT_ImpactEffectsCulled, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Merged"), STAT_ImpactEffectsMerged, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Over Budget"), STAT_ImpactEffectsOverBudget, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Spawned"), STAT_ImpactEffectsSpawned, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impact Effects Active"), STAT_ImpactEffectsActive, STATGROUP_FirstPerson);
+
+static TAutoConsoleVariable<float> CVarImpactEffectsMaxDistance(
+	TEXT("FirstPerson.ImpactEffects.MaxDistance"),
+	6000.0f,
+	TEXT("Impacts further than this from the local view are not spawned"));
+
+static TAutoConsoleVariable<float> CVarImpactEffectsNearDistance(
+	TEXT("FirstPerson.ImpactEffects.NearDistance"),
+	500.0f,
+	TEXT("Impacts closer than this to the local view are spawned even when off screen"));
+
+static TAutoConsoleVariable<int32> CVarImpactEffectsMaxActive(
+	TEXT("FirstPerson.ImpactEffects.MaxActive"),
+	32,
+	TEXT("Max number of impact emitters playing at once"));
+
+static TAutoConsoleVariable<int32> CVarImpactEffectsMaxPerFrame(
+	TEXT("FirstPerson.ImpactEffects.MaxPerFrame"),
+	8,
+	TEXT("Max number of impact emitters spawned in a single frame"));
+
+static TAutoConsoleVariable<float> CVarImpactEffectsMergeDistance(
+	TEXT("FirstPerson.ImpactEffects.MergeDistance"),
+	50.0f,
+	TEXT("Impacts of the same effect closer than this within a frame only spawn one emitter"));
+
+/** Extra angle added to the camera's half FOV so effects at the screen edges aren't culled */
+static constexpr float ImpactEffectViewMarginDegrees = 10.0f;
+
+void UImpactEffectSubsystem::QueueImpact(const UObject* WorldContextObject, UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+
+	// servers without a local view never show effects
+	if (!Template || !World || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	if (UImpactEffectSubsystem* Dispatcher = World->GetSubsystem<UImpactEffectSubsystem>())
+	{
+		FImpactEffectRequest& Request = Dispatcher->PendingImpacts.AddDefaulted_GetRef();
+		Request.Template = Template;
+		Request.Location = Location;
+		Request.Rotation = Rotation;
+
+		INC_DWORD_STAT(STAT_ImpactEffectsQueued);
+	}
+}
+
+bool UImpactEffectSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer) || IsRunningDedicatedServer())
+	{
+		return false;
+	}
+
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->GetNetMode() != NM_DedicatedServer;
+}
+
+void UImpactEffectSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ImpactEffectsDispatch);
+
+	// forget the emitters that finished playing. Their components went back to the world pool
+	ActiveEmitters.RemoveAllSwap([](const TWeakObjectPtr<UParticleSystemComponent>& Emitter) { return !Emitter.IsValid() || !Emitter->IsActive(); });
+
+	SET_DWORD_STAT(STAT_ImpactEffectsActive, ActiveEmitters.Num());
+
+	if (PendingImpacts.IsEmpty())
+	{
+		return;
+	}
+
+	// find the local view
+	FVector ViewLocation = FVector::ZeroVector;
+	FRotator ViewRotation = FRotator::ZeroRotator;
+	float CosHalfFOV = 0.0f;
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const bool bHasView = PlayerController && PlayerController->IsLocalController();
+
+	if (bHasView)
+	{
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		const float FOV = PlayerController->PlayerCameraManager ? PlayerController->PlayerCameraManager->GetFOVAngle() : 90.0f;
+		CosHalfFOV = FMath::Cos(FMath::DegreesToRadians(FMath::Min(FOV * 0.5f + ImpactEffectViewMarginDegrees, 180.0f)));
+	}
+
+	const FVector ViewDirection = ViewRotation.Vector();
+	const float MergeDistanceSquared = FMath::Square(CVarImpactEffectsMergeDistance.GetValueOnGameThread());
+	const int32 Budget = FMath::Min(CVarImpactEffectsMaxPerFrame.GetValueOnGameThread(), CVarImpactEffectsMaxActive.GetValueOnGameThread() - ActiveEmitters.Num());
+
+	// impacts spawned this frame, to merge the ones right next to them
+	TArray<const FImpactEffectRequest*, TInlineAllocator<16>> Spawned;
+
+	for (const FImpactEffectRequest& Request : PendingImpacts)
+	{
+		UParticleSystem* Template = Request.Template.Get();
+		if (!Template)
+		{
+			continue;
+		}
+
+		if (bHasView && !IsImpactVisible(Request.Location, ViewLocation, ViewDirection, CosHalfFOV))
+		{
+			INC_DWORD_STAT(STAT_ImpactEffectsCulled);
+			continue;
+		}
+
+		const bool bMerged = Spawned.ContainsByPredicate([&Request, MergeDistanceSquared](const FImpactEffectRequest* Other)
+		{
+			return Other->Template == Request.Template && FVector::DistSquared(Other->Location, Request.Location) < MergeDistanceSquared;
+		});
+
+		if (bMerged)
+		{
+			INC_DWORD_STAT(STAT_ImpactEffectsMerged);
+			continue;
+		}
+
+		if (Spawned.Num() >= Budget)
+		{
+			INC_DWORD_STAT(STAT_ImpactEffectsOverBudget);
+			continue;
+		}
+
+		// take the emitter from the world particle pool. It goes back on its own once it completes
+		if (UParticleSystemComponent* Emitter = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Template, Request.Location, Request.Rotation, true, EPSCPoolMethod::AutoRelease))
+		{
+			ActiveEmitters.Add(Emitter);
+			Spawned.Add(&Request);
+
+			INC_DWORD_STAT(STAT_ImpactEffectsSpawned);
+		}
+	}
+
+	PendingImpacts.Reset();
+}
+
+TStatId UImpactEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UImpactEffectSubsystem, STATGROUP_Tickables);
+}
+
+bool UImpactEffectSubsystem::IsImpactVisible(const FVector& Location, const FVector& ViewLocation, const FVector& ViewDirection, float CosHalfFOV)
+{
+	const FVector ToImpact = Location - ViewLocation;
+	const float DistanceSquared = ToImpact.SizeSquared();
+
+	// too far to notice
+	if (DistanceSquared > FMath::Square(CVarImpactEffectsMaxDistance.GetValueOnGameThread()))
+	{
+		return false;
+	}
+
+	// close enough that the smoke could drift into view
+	if (DistanceSquared < FMath::Square(CVarImpactEffectsNearDistance.GetValueOnGameThread()))
+	{
+		return true;
+	}
+
+	// inside the view cone?
+	return FVector::DotProduct(ToImpact, ViewDirection) >= CosHalfFOV * FMath::Sqrt(DistanceSquared);
+}
@@ -0,0 +1,62 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ImpactEffectSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/**
+ *  An impact effect waiting to be spawned
+ */
+struct FImpactEffectRequest
+{
+	/** Effect to spawn */
+	TWeakObjectPtr<UParticleSystem> Template;
+
+	/** World location of the impact */
+	FVector Location = FVector::ZeroVector;
+
+	/** Orientation of the effect */
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+/**
+ *  Cosmetic impact effects dispatcher
+ *  Not created on dedicated servers. On clients, impacts are queued and spawned once per frame:
+ *  requests close to each other are merged, impacts far away or outside the view are culled,
+ *  and the number of live emitters is capped. Emitters come from the world's particle pool.
+ */
+UCLASS()
+class FIRSTPERSON_API UImpactEffectSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Impacts queued this frame */
+	TArray<FImpactEffectRequest> PendingImpacts;
+
+	/** Emitters spawned by the dispatcher that may still be playing */
+	TArray<TWeakObjectPtr<UParticleSystemComponent>> ActiveEmitters;
+
+public:
+
+	/** Queues an impact effect. Does nothing where the dispatcher doesn't exist, e.g. on dedicated servers */
+	static void QueueImpact(const UObject* WorldContextObject, UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	//~Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	//~End USubsystem interface
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+
+protected:
+
+	/** Returns true if an impact at the given location is worth spawning for the given view */
+	static bool IsImpactVisible(const FVector& Location, const FVector& ViewLocation, const FVector& ViewDirection, float CosHalfFOV);
+};
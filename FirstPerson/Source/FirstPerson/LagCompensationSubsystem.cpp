@@ -0,0 +1,250 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "LagCompensationSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerState.h"
+#include "Components/CapsuleComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompensationRecord, STATGROUP_FirstPerson);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_LagCompensationRewind, STATGROUP_FirstPerson);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Trace"), STAT_LagCompensationTrace, STATGROUP_FirstPerson);
+
+static TAutoConsoleVariable<float> CVarLagCompensationMaxRewind(
+	TEXT("FirstPerson.LagCompensation.MaxRewind"),
+	0.4f,
+	TEXT("Maximum time in seconds hitscan traces can be rewound to compensate for latency"));
+
+/** Number of samples kept per character */
+static constexpr int32 LagCompensationHistorySize = 64;
+
+void FLagCompensationHistory::Record(const FLagCompensationSample& NewSample)
+{
+	if (Samples.Num() < LagCompensationHistorySize)
+	{
+		Samples.SetNum(LagCompensationHistorySize);
+	}
+
+	Head = (Head + 1) % LagCompensationHistorySize;
+	Samples[Head] = NewSample;
+	Count = FMath::Min(Count + 1, LagCompensationHistorySize);
+}
+
+bool FLagCompensationHistory::Sample(double Time, FLagCompensationSample& OutSample) const
+{
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	// walk back from the newest sample until we find one older than the requested time
+	const FLagCompensationSample* Newer = &Samples[Head];
+
+	if (Time >= Newer->Time)
+	{
+		OutSample = *Newer;
+		return true;
+	}
+
+	for (int32 Step = 1; Step < Count; ++Step)
+	{
+		const FLagCompensationSample& Older = Samples[(Head - Step + LagCompensationHistorySize) % LagCompensationHistorySize];
+
+		if (Older.Time <= Time)
+		{
+			// interpolate between the two bracketing samples
+			const double Span = Newer->Time - Older.Time;
+			const float Alpha = Span > UE_SMALL_NUMBER ? static_cast<float>((Time - Older.Time) / Span) : 1.0f;
+
+			OutSample.Time = Time;
+			OutSample.Location = FMath::Lerp(Older.Location, Newer->Location, Alpha);
+			OutSample.Rotation = FQuat::Slerp(Older.Rotation, Newer->Rotation, Alpha);
+			OutSample.Radius = FMath::Lerp(Older.Radius, Newer->Radius, Alpha);
+			OutSample.HalfHeight = FMath::Lerp(Older.HalfHeight, Newer->HalfHeight, Alpha);
+			OutSample.bCollisionEnabled = Alpha < 0.5f ? Older.bCollisionEnabled : Newer->bCollisionEnabled;
+			return true;
+		}
+
+		Newer = &Older;
+	}
+
+	// the requested time is older than our history, so use the oldest sample we have
+	OutSample = *Newer;
+	return true;
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(ACharacter* Character)
+{
+	if (!Character || Histories.ContainsByPredicate([Character](const FLagCompensationHistory& History) { return History.Character == Character; }))
+	{
+		return;
+	}
+
+	FLagCompensationHistory& History = Histories.AddDefaulted_GetRef();
+	History.Character = Character;
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(ACharacter* Character)
+{
+	Histories.RemoveAllSwap([Character](const FLagCompensationHistory& History) { return History.Character == Character; });
+}
+
+double ULagCompensationSubsystem::GetShooterViewTime(const APawn* Shooter) const
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	if (!Shooter || Shooter->IsLocallyControlled())
+	{
+		// locally controlled shooters see the current server state
+		return Now;
+	}
+
+	const APlayerState* PlayerState = Shooter->GetPlayerState();
+	if (!PlayerState)
+	{
+		return Now;
+	}
+
+	// the shot took half a round trip to get here, and the shooter was seeing
+	// a world state that was half a round trip old when it fired
+	const double RewindSeconds = FMath::Min(PlayerState->GetPingInMilliseconds() * 0.001, static_cast<double>(CVarLagCompensationMaxRewind.GetValueOnGameThread()));
+
+	return Now - RewindSeconds;
+}
+
+bool ULagCompensationSubsystem::RewindLineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, double RewindTime, const AActor* IgnoredActor) const
+{
+	FLagCompensationRewind RewoundCapsules;
+	Rewind(RewindTime, IgnoredActor, RewoundCapsules);
+
+	return RewoundLineTrace(RewoundCapsules, OutHit, Start, End);
+}
+
+void ULagCompensationSubsystem::Rewind(double RewindTime, const AActor* IgnoredActor, FLagCompensationRewind& OutRewind) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewind);
+
+	// trace the world while ignoring the live characters. They'll be tested at their rewound positions instead
+	OutRewind.QueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(LagCompensatedTrace), false, IgnoredActor);
+	OutRewind.Capsules.Reset();
+
+	for (const FLagCompensationHistory& History : Histories)
+	{
+		ACharacter* Character = History.Character.Get();
+
+		if (!Character)
+		{
+			continue;
+		}
+
+		OutRewind.QueryParams.AddIgnoredActor(Character);
+
+		FLagCompensationSample Sample;
+
+		if (Character != IgnoredActor && History.Sample(RewindTime, Sample) && Sample.bCollisionEnabled)
+		{
+			OutRewind.Capsules.Emplace(Character, Sample);
+		}
+	}
+}
+
+bool ULagCompensationSubsystem::RewoundLineTrace(const FLagCompensationRewind& Rewind, FHitResult& OutHit, const FVector& Start, const FVector& End) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationTrace);
+
+	GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, Rewind.QueryParams);
+
+	const FVector TraceDir = (End - Start).GetSafeNormal();
+	float ClosestDistance = OutHit.bBlockingHit ? OutHit.Distance : FVector::Dist(Start, End);
+
+	ACharacter* HitCharacter = nullptr;
+	FVector HitLocation = FVector::ZeroVector;
+	FVector HitNormal = FVector::ZeroVector;
+
+	// test the trace against every rewound capsule
+	for (const TPair<ACharacter*, FLagCompensationSample>& Capsule : Rewind.Capsules)
+	{
+		const FLagCompensationSample& Sample = Capsule.Value;
+
+		// find the capsule's inner segment
+		const FVector Up = Sample.Rotation.GetUpVector() * FMath::Max(0.0f, Sample.HalfHeight - Sample.Radius);
+		const FVector SegmentA = Sample.Location - Up;
+		const FVector SegmentB = Sample.Location + Up;
+
+		// closest points between the trace and the capsule segment
+		FVector OnTrace, OnCapsule;
+		FMath::SegmentDistToSegmentSafe(Start, End, SegmentA, SegmentB, OnTrace, OnCapsule);
+
+		const float DistSquared = FVector::DistSquared(OnTrace, OnCapsule);
+		if (DistSquared > FMath::Square(Sample.Radius))
+		{
+			continue;
+		}
+
+		// step back from the closest point to the capsule surface
+		const float EntryDistance = FMath::Max(0.0f, static_cast<float>(FVector::Dist(Start, OnTrace)) - FMath::Sqrt(FMath::Square(Sample.Radius) - DistSquared));
+
+		if (EntryDistance < ClosestDistance)
+		{
+			ClosestDistance = EntryDistance;
+			HitCharacter = Capsule.Key;
+			HitLocation = Start + TraceDir * EntryDistance;
+			HitNormal = (HitLocation - OnCapsule).GetSafeNormal();
+		}
+	}
+
+	// did a rewound capsule block the trace before the world did?
+	if (HitCharacter)
+	{
+		OutHit = FHitResult(HitCharacter, HitCharacter->GetCapsuleComponent(), HitLocation, HitNormal);
+		OutHit.bBlockingHit = true;
+		OutHit.TraceStart = Start;
+		OutHit.TraceEnd = End;
+		OutHit.Distance = ClosestDistance;
+		OutHit.Time = ClosestDistance / FMath::Max(UE_SMALL_NUMBER, static_cast<float>(FVector::Dist(Start, End)));
+		OutHit.ImpactPoint = HitLocation;
+		OutHit.ImpactNormal = HitNormal;
+	}
+
+	return OutHit.bBlockingHit;
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	// only the server resolves hits
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// drop histories for characters that are gone
+	Histories.RemoveAllSwap([](const FLagCompensationHistory& History) { return !History.Character.IsValid(); });
+
+	// record this frame's capsules
+	for (FLagCompensationHistory& History : Histories)
+	{
+		const UCapsuleComponent* Capsule = History.Character->GetCapsuleComponent();
+
+		FLagCompensationSample Sample;
+		Sample.Time = Now;
+		Sample.Location = Capsule->GetComponentLocation();
+		Sample.Rotation = Capsule->GetComponentQuat();
+		Sample.Radius = Capsule->GetScaledCapsuleRadius();
+		Sample.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+		Sample.bCollisionEnabled = Capsule->IsCollisionEnabled();
+
+		History.Record(Sample);
+	}
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
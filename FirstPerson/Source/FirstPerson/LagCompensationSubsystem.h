@@ -0,0 +1,117 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CollisionQueryParams.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ACharacter;
+class APawn;
+
+/**
+ *  Capsule transform of a character at a given server time
+ */
+struct FLagCompensationSample
+{
+	/** Server time the sample was taken at */
+	double Time = 0.0;
+
+	/** Capsule center */
+	FVector Location = FVector::ZeroVector;
+
+	/** Capsule orientation */
+	FQuat Rotation = FQuat::Identity;
+
+	/** Scaled capsule radius */
+	float Radius = 0.0f;
+
+	/** Scaled capsule half height */
+	float HalfHeight = 0.0f;
+
+	/** False if the capsule had its collision disabled, e.g. while dead */
+	bool bCollisionEnabled = true;
+};
+
+/**
+ *  Ring buffer of capsule samples for a single character
+ */
+struct FLagCompensationHistory
+{
+	/** Character this history belongs to */
+	TWeakObjectPtr<ACharacter> Character;
+
+	/** Fixed size sample storage */
+	TArray<FLagCompensationSample> Samples;
+
+	/** Index of the most recent sample */
+	int32 Head = INDEX_NONE;
+
+	/** Number of valid samples */
+	int32 Count = 0;
+
+	/** Adds a new sample, overwriting the oldest one when full */
+	void Record(const FLagCompensationSample& Sample);
+
+	/** Interpolates the capsule at the given time. Returns false if there's no sample to interpolate from */
+	bool Sample(double Time, FLagCompensationSample& OutSample) const;
+};
+
+/**
+ *  Character capsules rewound to a single time
+ *  Lets every trace of a shot share one rewind
+ */
+struct FLagCompensationRewind
+{
+	/** Rewound characters and their capsules */
+	TArray<TPair<ACharacter*, FLagCompensationSample>, TInlineAllocator<16>> Capsules;
+
+	/** World trace parameters. The live characters are ignored in favor of their rewound capsules */
+	FCollisionQueryParams QueryParams;
+};
+
+/**
+ *  Server side lag compensation for hitscan weapons
+ *  Records a ring buffer of character capsule transforms every frame,
+ *  and resolves traces against the capsules as they were at the shooter's view time.
+ */
+UCLASS()
+class FIRSTPERSON_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Recorded histories by character */
+	TArray<FLagCompensationHistory> Histories;
+
+public:
+
+	/** Starts recording the given character */
+	void RegisterCharacter(ACharacter* Character);
+
+	/** Stops recording the given character */
+	void UnregisterCharacter(ACharacter* Character);
+
+	/** Returns the server time the given shooter was seeing when it fired, based on its connection latency */
+	double GetShooterViewTime(const APawn* Shooter) const;
+
+	/**
+	 *  Traces against the world and against the recorded character capsules rewound to the given time
+	 *  Returns true if something was hit
+	 */
+	bool RewindLineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, double RewindTime, const AActor* IgnoredActor) const;
+
+	/** Rewinds the recorded character capsules to the given time, for several traces to share */
+	void Rewind(double RewindTime, const AActor* IgnoredActor, FLagCompensationRewind& OutRewind) const;
+
+	/**
+	 *  Traces against the world and against already rewound character capsules
+	 *  Returns true if something was hit
+	 */
+	bool RewoundLineTrace(const FLagCompensationRewind& Rewind, FHitResult& OutHit, const FVector& Start, const FVector& End) const;
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+};
@@ -0,0 +1,294 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "NetUpdateRateSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_CYCLE_STAT(TEXT("Net Update Rate Evaluation"), STAT_NetUpdateRateEvaluation, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Adaptive Net Actors"), STAT_AdaptiveNetActors, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Adaptive Net Actors Active"), STAT_AdaptiveNetActorsActive, STATGROUP_FirstPerson);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Adaptive Net Average Rate"), STAT_AdaptiveNetAverageRate, STATGROUP_FirstPerson);
+
+CSV_DEFINE_CATEGORY(FirstPersonNetRate, true);
+
+static TAutoConsoleVariable<bool> CVarNetRateEnabled(
+	TEXT("FirstPerson.NetRate.Enabled"),
+	true,
+	TEXT("If true, registered actors adapt their net update frequency to their activity and distance from viewers"));
+
+static TAutoConsoleVariable<float> CVarNetRateMinRate(
+	TEXT("FirstPerson.NetRate.MinRate"),
+	2.0f,
+	TEXT("Update frequency in Hz idle or distant actors drop to"));
+
+static TAutoConsoleVariable<float> CVarNetRateNearDistance(
+	TEXT("FirstPerson.NetRate.NearDistance"),
+	1500.0f,
+	TEXT("Distance in cm from a viewer within which actors are fully relevant"));
+
+static TAutoConsoleVariable<float> CVarNetRateFarDistance(
+	TEXT("FirstPerson.NetRate.FarDistance"),
+	8000.0f,
+	TEXT("Distance in cm from every viewer beyond which actors drop to the minimum rate"));
+
+static TAutoConsoleVariable<float> CVarNetRateInterval(
+	TEXT("FirstPerson.NetRate.Interval"),
+	0.25f,
+	TEXT("Time in seconds between update frequency evaluations"));
+
+/** Speed above which an actor counts as moving */
+static constexpr float MovingSpeed = 10.0f;
+
+/** Time an actor counts as active after reporting activity */
+static constexpr double ActivityHoldTime = 1.0;
+
+/** Relevance of idle actors, relative to active ones */
+static constexpr float IdleScale = 0.25f;
+
+/** Relevance of actors behind a viewer, relative to those in front */
+static constexpr float BehindScale = 0.5f;
+
+/** Net priority multiplier for active actors */
+static constexpr float ActivePriorityScale = 2.0f;
+
+/** Net priority multiplier for actors at the far distance */
+static constexpr float FarPriorityScale = 0.5f;
+
+void UNetUpdateRateSubsystem::RegisterActor(AActor* Actor)
+{
+	if (!Actor || !Actor->HasAuthority())
+	{
+		return;
+	}
+
+	FTrackedActor& Tracked = TrackedActors.FindOrAdd(Actor);
+	Tracked.Actor = Actor;
+	Tracked.MaxRate = Actor->GetClass()->GetDefaultObject<AActor>()->GetNetUpdateFrequency();
+	Tracked.CurrentRate = Actor->GetNetUpdateFrequency();
+}
+
+void UNetUpdateRateSubsystem::UnregisterActor(AActor* Actor)
+{
+	FTrackedActor Tracked;
+
+	if (TrackedActors.RemoveAndCopyValue(Actor, Tracked) && IsValid(Actor))
+	{
+		Actor->SetNetUpdateFrequency(Tracked.MaxRate);
+	}
+}
+
+void UNetUpdateRateSubsystem::NotifyActivity(AActor* Actor)
+{
+	if (FTrackedActor* Tracked = TrackedActors.Find(Actor))
+	{
+		Tracked->LastActivityTime = GetWorld()->GetTimeSeconds();
+
+		// don't wait for the next evaluation to speed up an idle actor
+		if (!Tracked->bActive)
+		{
+			Tracked->bActive = true;
+			Tracked->CurrentRate = Tracked->MaxRate;
+
+			Actor->SetNetUpdateFrequency(Tracked->MaxRate);
+			Actor->ForceNetUpdate();
+		}
+	}
+}
+
+float UNetUpdateRateSubsystem::ScaleNetPriority(const AActor* Actor, const FVector& ViewPos, float Priority)
+{
+	const UNetUpdateRateSubsystem* Subsystem = Actor->GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>();
+
+	if (!Subsystem || !CVarNetRateEnabled.GetValueOnGameThread())
+	{
+		return Priority;
+	}
+
+	const FTrackedActor* Tracked = Subsystem->TrackedActors.Find(Actor);
+
+	if (!Tracked)
+	{
+		return Priority;
+	}
+
+	// each connection favors active actors near its own view
+	const float DistanceFactor = GetDistanceFactor(FVector::Dist(Actor->GetActorLocation(), ViewPos));
+	const float DistanceScale = FMath::Lerp(FarPriorityScale, 1.0f, DistanceFactor);
+
+	return Priority * DistanceScale * (Tracked->bActive ? ActivePriorityScale : 1.0f);
+}
+
+void UNetUpdateRateSubsystem::DumpClassRates() const
+{
+	UE_LOG(LogFirstPerson, Log, TEXT("Adaptive net update rates in %s:"), *GetNameSafe(GetWorld()));
+
+	for (const TPair<TObjectKey<UClass>, FClassRates>& Pair : ClassRates)
+	{
+		const FClassRates& Rates = Pair.Value;
+
+		if (Rates.NumActors > 0)
+		{
+			UE_LOG(LogFirstPerson, Log, TEXT("  %s: %d actors, average %.1f Hz of %.1f Hz"),
+				*GetNameSafe(Pair.Key.ResolveObjectPtr()), Rates.NumActors, Rates.TotalRate / Rates.NumActors, Rates.TotalMaxRate / Rates.NumActors);
+		}
+	}
+}
+
+void UNetUpdateRateSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceEvaluation += DeltaTime;
+
+	if (TimeSinceEvaluation < CVarNetRateInterval.GetValueOnGameThread() || TrackedActors.IsEmpty())
+	{
+		return;
+	}
+
+	TimeSinceEvaluation = 0.0f;
+
+	EvaluateActors();
+}
+
+TStatId UNetUpdateRateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNetUpdateRateSubsystem, STATGROUP_Tickables);
+}
+
+void UNetUpdateRateSubsystem::EvaluateActors()
+{
+	SCOPE_CYCLE_COUNTER(STAT_NetUpdateRateEvaluation);
+
+	const bool bEnabled = CVarNetRateEnabled.GetValueOnGameThread();
+	const double Now = GetWorld()->GetTimeSeconds();
+	const float NearDistance = CVarNetRateNearDistance.GetValueOnGameThread();
+
+	// where every player is looking from
+	TArray<TPair<FVector, FVector>, TInlineAllocator<16>> Viewers;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PC = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			Viewers.Emplace(ViewLocation, ViewRotation.Vector());
+		}
+	}
+
+	ClassRates.Reset();
+
+	int32 NumActive = 0;
+	float TotalRate = 0.0f;
+
+	for (auto It = TrackedActors.CreateIterator(); It; ++It)
+	{
+		FTrackedActor& Tracked = It.Value();
+		AActor* Actor = Tracked.Actor.Get();
+
+		if (!Actor)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// dormant and hidden actors aren't replicating anything
+		if (Actor->GetNetDormancy() > DORM_Awake || Actor->IsHidden())
+		{
+			continue;
+		}
+
+		Tracked.bActive = Actor->GetVelocity().SizeSquared() > FMath::Square(MovingSpeed) || Now - Tracked.LastActivityTime < ActivityHoldTime;
+
+		// relevance to the best placed viewer
+		float Relevance = 0.0f;
+
+		for (const TPair<FVector, FVector>& Viewer : Viewers)
+		{
+			const FVector ToActor = Actor->GetActorLocation() - Viewer.Key;
+			const float Distance = ToActor.Size();
+			const bool bInFront = Distance < NearDistance || (ToActor | Viewer.Value) > 0.0f;
+
+			Relevance = FMath::Max(Relevance, GetDistanceFactor(Distance) * (bInFront ? 1.0f : BehindScale));
+		}
+
+		const float MinRate = FMath::Min(CVarNetRateMinRate.GetValueOnGameThread(), Tracked.MaxRate);
+		const float Score = Relevance * (Tracked.bActive ? 1.0f : IdleScale);
+		const float Rate = bEnabled ? FMath::Lerp(MinRate, Tracked.MaxRate, Score) : Tracked.MaxRate;
+
+		// skip small changes
+		if (!FMath::IsNearlyEqual(Rate, Tracked.CurrentRate, 0.5f))
+		{
+			Tracked.CurrentRate = Rate;
+			Actor->SetNetUpdateFrequency(Rate);
+		}
+
+		FClassRates& Rates = ClassRates.FindOrAdd(Actor->GetClass());
+		++Rates.NumActors;
+		Rates.TotalRate += Tracked.CurrentRate;
+		Rates.TotalMaxRate += Tracked.MaxRate;
+
+		NumActive += Tracked.bActive ? 1 : 0;
+		TotalRate += Tracked.CurrentRate;
+	}
+
+	SET_DWORD_STAT(STAT_AdaptiveNetActors, TrackedActors.Num());
+	SET_DWORD_STAT(STAT_AdaptiveNetActorsActive, NumActive);
+	SET_FLOAT_STAT(STAT_AdaptiveNetAverageRate, TrackedActors.Num() > 0 ? TotalRate / TrackedActors.Num() : 0.0f);
+
+#if CSV_PROFILER
+	// per class counters, so budgets can be tuned per map from a csv capture
+	if (FCsvProfiler::Get()->IsCapturing())
+	{
+		for (const TPair<TObjectKey<UClass>, FClassRates>& Pair : ClassRates)
+		{
+			const UClass* Class = Pair.Key.ResolveObjectPtr();
+			const FClassRates& Rates = Pair.Value;
+
+			if (Class && Rates.NumActors > 0)
+			{
+				FCsvProfiler::RecordCustomStat(FName(*FString::Printf(TEXT("%s_Actors"), *Class->GetName())), CSV_CATEGORY_INDEX(FirstPersonNetRate), Rates.NumActors, ECsvCustomStatOp::Set);
+				FCsvProfiler::RecordCustomStat(FName(*FString::Printf(TEXT("%s_AverageRate"), *Class->GetName())), CSV_CATEGORY_INDEX(FirstPersonNetRate), Rates.TotalRate / Rates.NumActors, ECsvCustomStatOp::Set);
+			}
+		}
+	}
+#endif
+}
+
+float UNetUpdateRateSubsystem::GetDistanceFactor(float Distance)
+{
+	const float NearDistance = CVarNetRateNearDistance.GetValueOnGameThread();
+	const float FarDistance = FMath::Max(NearDistance + 1.0f, CVarNetRateFarDistance.GetValueOnGameThread());
+
+	return 1.0f - FMath::SmoothStep(NearDistance, FarDistance, Distance);
+}
+
+#if !UE_BUILD_SHIPPING
+
+static FAutoConsoleCommand CmdDumpNetUpdateRates(
+	TEXT("FirstPerson.NetRate.Dump"),
+	TEXT("Logs the average adaptive net update rate of every registered class, per server world"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			const UWorld* World = Context.World();
+
+			if (!World || World->GetNetMode() == NM_Client)
+			{
+				continue;
+			}
+
+			if (const UNetUpdateRateSubsystem* Subsystem = World->GetSubsystem<UNetUpdateRateSubsystem>())
+			{
+				Subsystem->DumpClassRates();
+			}
+		}
+	}));
+
+#endif
@@ -0,0 +1,85 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NetUpdateRateSubsystem.generated.h"
+
+/**
+ *  Adapts the net update frequency of registered actors to what they're doing and who's watching
+ *  A few times per second the server scores every awake registered actor. Actors that are moving or recently fired,
+ *  close to and in front of a player's view, run at their class's default update frequency. Idle or distant actors drop
+ *  towards the minimum rate. Registered actors also scale their per-connection net priority through ScaleNetPriority,
+ *  so each connection favors the active actors near its own view.
+ */
+UCLASS()
+class FIRSTPERSON_API UNetUpdateRateSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** A registered actor */
+	struct FTrackedActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		/** Class default update frequency. The rate active actors run at */
+		float MaxRate = 0.0f;
+
+		/** Update frequency currently applied */
+		float CurrentRate = 0.0f;
+
+		/** Last time the actor reported activity, e.g. a shot */
+		double LastActivityTime = -UE_BIG_NUMBER;
+
+		/** If true, the actor was moving or firing at the last evaluation */
+		bool bActive = false;
+	};
+
+	/** Update rates of one class at the last evaluation */
+	struct FClassRates
+	{
+		int32 NumActors = 0;
+		float TotalRate = 0.0f;
+		float TotalMaxRate = 0.0f;
+	};
+
+	/** Registered actors */
+	TMap<TObjectKey<AActor>, FTrackedActor> TrackedActors;
+
+	/** Rates by class, for the dump command and the FirstPersonNetRate csv category */
+	TMap<TObjectKey<UClass>, FClassRates> ClassRates;
+
+	/** Time since the last evaluation */
+	float TimeSinceEvaluation = 0.0f;
+
+public:
+
+	/** Starts adapting an actor's update frequency. Server only */
+	void RegisterActor(AActor* Actor);
+
+	/** Stops adapting an actor's update frequency and restores its class default */
+	void UnregisterActor(AActor* Actor);
+
+	/** Tells the subsystem an actor did something worth replicating promptly, e.g. fired a shot */
+	void NotifyActivity(AActor* Actor);
+
+	/** Scales an actor's net priority for a connection by its activity and distance from the connection's view */
+	static float ScaleNetPriority(const AActor* Actor, const FVector& ViewPos, float Priority);
+
+	/** Logs the average update rate of every registered class */
+	void DumpClassRates() const;
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+
+protected:
+
+	/** Scores every registered actor and applies its update frequency */
+	void EvaluateActors();
+
+	/** Returns how close an actor is to the near distance, from 1 up close to 0 at the far distance */
+	static float GetDistanceFactor(float Distance);
+};
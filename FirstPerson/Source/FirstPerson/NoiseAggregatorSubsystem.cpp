@@ -0,0 +1,101 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "NoiseAggregatorSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Noise Flush"), STAT_AINoiseFlush, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Noises Received"), STAT_AINoisesReceived, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Noises Emitted"), STAT_AINoisesEmitted, STATGROUP_FirstPerson);
+
+static TAutoConsoleVariable<float> CVarNoiseMergeWindow(
+	TEXT("FirstPerson.Noise.MergeWindow"),
+	0.1f,
+	TEXT("Time in seconds noises with the same instigator, tag and cell are merged over before being submitted. 0 merges within a frame only"));
+
+static TAutoConsoleVariable<float> CVarNoiseCellSize(
+	TEXT("FirstPerson.Noise.CellSize"),
+	500.0f,
+	TEXT("Size in cm of the spatial cells noises are merged in"));
+
+void UNoiseAggregatorSubsystem::ReportNoise(AActor* NoiseMaker, APawn* NoiseInstigator, const FVector& NoiseLocation, float Loudness, float MaxRange, FName Tag)
+{
+	// perception only runs on the server
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_AINoisesReceived);
+
+	const float CellSize = FMath::Max(1.0f, CVarNoiseCellSize.GetValueOnGameThread());
+
+	FNoiseKey Key;
+	Key.Instigator = NoiseInstigator;
+	Key.Tag = Tag;
+	Key.Cell = FIntVector(FMath::FloorToInt(NoiseLocation.X / CellSize), FMath::FloorToInt(NoiseLocation.Y / CellSize), FMath::FloorToInt(NoiseLocation.Z / CellSize));
+
+	FMergedNoise* Noise = PendingNoises.Find(Key);
+
+	if (!Noise)
+	{
+		FMergedNoise& NewNoise = PendingNoises.Add(Key);
+		NewNoise.NoiseMaker = NoiseMaker;
+		NewNoise.Instigator = NoiseInstigator;
+		NewNoise.Location = NoiseLocation;
+		NewNoise.Loudness = Loudness;
+		NewNoise.MaxRange = MaxRange;
+		NewNoise.FirstReportTime = GetWorld()->GetTimeSeconds();
+		return;
+	}
+
+	// the merge reaches as far as its farthest noise. A range of 0 means unlimited
+	Noise->MaxRange = (MaxRange > 0.0f && Noise->MaxRange > 0.0f) ? FMath::Max(Noise->MaxRange, MaxRange) : 0.0f;
+
+	// the loudest noise speaks for the merge
+	if (Loudness > Noise->Loudness)
+	{
+		Noise->NoiseMaker = NoiseMaker;
+		Noise->Location = NoiseLocation;
+		Noise->Loudness = Loudness;
+	}
+}
+
+void UNoiseAggregatorSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AINoiseFlush);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const float MergeWindow = CVarNoiseMergeWindow.GetValueOnGameThread();
+
+	for (auto It = PendingNoises.CreateIterator(); It; ++It)
+	{
+		const FMergedNoise& Noise = It.Value();
+
+		// keep merging until the window closes
+		if (Now - Noise.FirstReportTime < MergeWindow)
+		{
+			continue;
+		}
+
+		// fall back to the instigator if the noise maker is gone, like a recycled projectile
+		AActor* NoiseMaker = Noise.NoiseMaker.IsValid() ? Noise.NoiseMaker.Get() : Noise.Instigator.Get();
+
+		if (NoiseMaker)
+		{
+			NoiseMaker->MakeNoise(Noise.Loudness, Noise.Instigator.Get(), Noise.Location, Noise.MaxRange, It.Key().Tag);
+
+			INC_DWORD_STAT(STAT_AINoisesEmitted);
+		}
+
+		It.RemoveCurrent();
+	}
+}
+
+TStatId UNoiseAggregatorSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNoiseAggregatorSubsystem, STATGROUP_Tickables);
+}
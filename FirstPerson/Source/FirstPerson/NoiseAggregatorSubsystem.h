@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NoiseAggregatorSubsystem.generated.h"
+
+class APawn;
+
+/**
+ *  Merges AI perception noises before they reach the perception system
+ *  Noises from the same instigator with the same tag, landing in the same spatial cell within the merge window,
+ *  become a single stimulus at the loudest noise's location and loudness. Merged noises are submitted once per frame,
+ *  so a full auto weapon and its impacts cost each listener one stimulus per cell instead of one per shot and hit.
+ *  Only the server reports noises, since perception only runs there.
+ */
+UCLASS()
+class FIRSTPERSON_API UNoiseAggregatorSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** What merges two noises */
+	struct FNoiseKey
+	{
+		TObjectKey<APawn> Instigator;
+		FName Tag;
+		FIntVector Cell;
+
+		bool operator==(const FNoiseKey& Other) const
+		{
+			return Instigator == Other.Instigator && Tag == Other.Tag && Cell == Other.Cell;
+		}
+
+		friend uint32 GetTypeHash(const FNoiseKey& Key)
+		{
+			return HashCombineFast(HashCombineFast(GetTypeHash(Key.Instigator), GetTypeHash(Key.Tag)), GetTypeHash(Key.Cell));
+		}
+	};
+
+	/** A noise waiting to be submitted, merged from every report sharing its key */
+	struct FMergedNoise
+	{
+		TWeakObjectPtr<AActor> NoiseMaker;
+		TWeakObjectPtr<APawn> Instigator;
+		FVector Location = FVector::ZeroVector;
+		float Loudness = 0.0f;
+		float MaxRange = 0.0f;
+		double FirstReportTime = 0.0;
+	};
+
+	/** Noises waiting for their merge window to close */
+	TMap<FNoiseKey, FMergedNoise> PendingNoises;
+
+public:
+
+	/** Reports a noise. Takes the same parameters as AActor::MakeNoise, plus the actor making it */
+	void ReportNoise(AActor* NoiseMaker, APawn* NoiseInstigator, const FVector& NoiseLocation, float Loudness, float MaxRange, FName Tag);
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+};
@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "PooledProjectile.h"
+
+// Add default functionality here for any IPooledProjectile functions that are not pure virtual.
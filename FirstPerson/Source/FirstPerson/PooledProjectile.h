@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Engine/NetSerialization.h"
+#include "PooledProjectile.generated.h"
+
+/**
+ *  Launch state replicated by pooled projectiles
+ *  Clients don't get a new spawn for a reused projectile, so they move their copy to the new launch from this
+ */
+USTRUCT()
+struct FPooledProjectileLaunch
+{
+	GENERATED_BODY()
+
+	/** Launch location */
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	/** Launch direction */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/** Incremented on every launch so repeated launches from the same spot still replicate */
+	UPROPERTY()
+	uint8 Generation = 0;
+};
+
+/**
+ *  How long and how far a pooled projectile may fly before the lifetime manager takes it back
+ */
+struct FProjectileFlightLimits
+{
+	/** Max time in flight, in seconds */
+	float MaxFlightTime = 10.0f;
+
+	/** Max distance from the launch location, in cm */
+	float MaxFlightRange = 50000.0f;
+};
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UPooledProjectile : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ *  Common interface for projectiles that can be recycled by the projectile pool subsystem
+ *  Implementers reset their movement, collision and hit state in place instead of being destroyed and respawned
+ */
+class FIRSTPERSON_API IPooledProjectile
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Called after the projectile has been taken out of the pool and placed at its new spawn transform */
+	virtual void OnAcquiredFromPool() = 0;
+
+	/** Called when the projectile is handed back to the pool. Should stop movement, disable collision and hide it */
+	virtual void OnReturnedToPool() = 0;
+
+	/** Returns how long and how far the projectile may fly before it's taken back */
+	virtual FProjectileFlightLimits GetFlightLimits() const { return FProjectileFlightLimits(); }
+
+	/** Returns true while the projectile waits in its pool */
+	bool IsInPool() const { return bInPool; }
+
+private:
+
+	friend class UProjectilePoolSubsystem;
+
+	/** Set by the pool subsystem while the projectile waits in its pool */
+	bool bInPool = false;
+};
@@ -0,0 +1,53 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectileBallistics.h"
+
+int32 FProjectileBallistics::ConsumeSteps(float& Accumulator, float DeltaTime)
+{
+	Accumulator += DeltaTime;
+
+	const int32 Steps = FMath::Min(FMath::FloorToInt32(Accumulator / FixedStep), MaxStepsPerFrame);
+	Accumulator -= Steps * FixedStep;
+
+	// drop the time we couldn't catch up with
+	Accumulator = FMath::Min(Accumulator, FixedStep);
+
+	return Steps;
+}
+
+void FProjectileBallistics::Step(TArrayView<FVector> Positions, TArrayView<FVector> Velocities, TArrayView<const float> GravityZ, TArrayView<const float> DragCoefficients)
+{
+	check(Positions.Num() == Velocities.Num() && Positions.Num() == GravityZ.Num() && Positions.Num() == DragCoefficients.Num());
+
+	const VectorRegister4Double StepTime = VectorSetFloat1(static_cast<double>(FixedStep));
+
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		VectorRegister4Double Position = VectorLoadFloat3_W0(&Positions[Index].X);
+		VectorRegister4Double Velocity = VectorLoadFloat3_W0(&Velocities[Index].X);
+
+		// a = g - k * |v| * v
+		// separate multiplies and adds, so the result doesn't depend on whether the target fuses them
+		const VectorRegister4Double Gravity = VectorSet(0.0, 0.0, static_cast<double>(GravityZ[Index]), 0.0);
+		const VectorRegister4Double Speed = VectorSqrt(VectorDot3(Velocity, Velocity));
+		const VectorRegister4Double DragScale = VectorMultiply(VectorSetFloat1(static_cast<double>(DragCoefficients[Index])), Speed);
+		const VectorRegister4Double Acceleration = VectorSubtract(Gravity, VectorMultiply(DragScale, Velocity));
+
+		// update the velocity first, then move with the new velocity
+		Velocity = VectorAdd(Velocity, VectorMultiply(Acceleration, StepTime));
+		Position = VectorAdd(Position, VectorMultiply(Velocity, StepTime));
+
+		VectorStoreFloat3(Position, &Positions[Index].X);
+		VectorStoreFloat3(Velocity, &Velocities[Index].X);
+	}
+}
+
+FVector FProjectileBallistics::Bounce(const FVector& Velocity, const FVector& Normal, float Restitution, float Friction)
+{
+	// split the velocity along the surface normal
+	const FVector NormalVelocity = Normal * FVector::DotProduct(Velocity, Normal);
+	const FVector TangentVelocity = Velocity - NormalVelocity;
+
+	return TangentVelocity * (1.0f - FMath::Clamp(Friction, 0.0f, 1.0f)) - NormalVelocity * FMath::Clamp(Restitution, 0.0f, 1.0f);
+}
@@ -0,0 +1,32 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Fixed step ballistics for projectiles simulated without a movement component
+ *  Steps don't depend on the frame rate, so a server and a client running the same build step
+ *  a projectile through the exact same positions. Projectiles are kept in structure-of-arrays form
+ *  and stepped together with vector registers.
+ */
+struct FIRSTPERSON_API FProjectileBallistics
+{
+	/** Length of a simulation step */
+	static constexpr float FixedStep = 1.0f / 120.0f;
+
+	/** Max steps run for a single frame, so a hitch doesn't make the next frames even longer */
+	static constexpr int32 MaxStepsPerFrame = 16;
+
+	/** Adds the frame time to the accumulator and returns the number of fixed steps to run */
+	static int32 ConsumeSteps(float& Accumulator, float DeltaTime);
+
+	/**
+	 *  Steps every projectile once under gravity and quadratic drag, with semi-implicit Euler
+	 *  All arrays must have the same length. Drag coefficients are in 1/cm
+	 */
+	static void Step(TArrayView<FVector> Positions, TArrayView<FVector> Velocities, TArrayView<const float> GravityZ, TArrayView<const float> DragCoefficients);
+
+	/** Reflects a velocity off a surface. The normal part is scaled by the restitution, the tangent part by one minus the friction */
+	static FVector Bounce(const FVector& Velocity, const FVector& Normal, float Restitution, float Friction);
+};
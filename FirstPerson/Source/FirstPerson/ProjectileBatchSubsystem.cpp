@@ -0,0 +1,356 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectileBatchSubsystem.h"
+#include "ProjectileBallistics.h"
+#include "AsyncProjectileSimulation.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Components/PrimitiveComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PBDRigidsSolver.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batched Projectiles Integrate"), STAT_BatchedProjectilesIntegrate, STATGROUP_FirstPerson);
+DECLARE_CYCLE_STAT(TEXT("Batched Projectiles Resolve"), STAT_BatchedProjectilesResolve, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Batched Projectiles Live"), STAT_BatchedProjectilesLive, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Projectile Impacts"), STAT_BatchedProjectileImpacts, STATGROUP_FirstPerson);
+
+/** Object channel of the "Projectile" collision profile set up in DefaultEngine.ini */
+static constexpr ECollisionChannel BatchedProjectileChannel = ECC_GameTraceChannel1;
+
+static TAutoConsoleVariable<bool> CVarBatchedProjectilesAsyncPhysics(
+	TEXT("FirstPerson.BatchedProjectiles.AsyncPhysics"),
+	false,
+	TEXT("If true, batched projectiles are stepped and traced on the physics thread. Read when the world begins play.\n")
+	TEXT("Pair with async physics (Project Settings > Physics > Tick Physics Async) to run them at a fixed rate off the game thread"));
+
+void UProjectileBatchSubsystem::LaunchProjectile(const FBatchedProjectileParams& Params, const FTransform& LaunchTransform, AActor* Owner)
+{
+	if (AsyncSimulation)
+	{
+		LaunchAsyncProjectile(Params, LaunchTransform, Owner);
+		return;
+	}
+
+	Positions.Add(LaunchTransform.GetLocation());
+	Velocities.Add(LaunchTransform.GetRotation().GetForwardVector() * Params.Speed);
+	Radii.Add(Params.Radius);
+	GravityZs.Add(GetWorld()->GetGravityZ() * Params.GravityScale);
+	Drags.Add(Params.DragCoefficient);
+	BouncesLeft.Add(static_cast<uint8>(FMath::Clamp(Params.MaxBounces, 0, MAX_uint8)));
+	Damages.Add(Params.Damage);
+	Impacted.Add(false);
+	Ages.Add(0.0f);
+	TypeIndices.Add(FindOrAddType(Params));
+	Owners.Add(Owner);
+	PendingSweeps.AddDefaulted();
+}
+
+void UProjectileBatchSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!CVarBatchedProjectilesAsyncPhysics.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	if (FPhysScene* PhysScene = InWorld.GetPhysicsScene())
+	{
+		AsyncSimulation = PhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FAsyncProjectileSimCallback>();
+	}
+}
+
+void UProjectileBatchSubsystem::Deinitialize()
+{
+	if (AsyncSimulation)
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(AsyncSimulation);
+		}
+
+		AsyncSimulation = nullptr;
+		AsyncProjectiles.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UProjectileBatchSubsystem::Tick(float DeltaTime)
+{
+	// resolve what the physics thread simulated since last frame
+	if (AsyncSimulation)
+	{
+		ResolveAsyncEvents();
+	}
+
+	// resolve the sweeps issued last frame
+	TBitArray<> Remove(false, Positions.Num());
+	ResolveSweeps(Remove);
+
+	// remove the projectiles that hit something or expired, back to front so swapped in entries have already been checked
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		if (Remove[Index])
+		{
+			RemoveProjectileAtSwap(Index);
+		}
+	}
+
+	// move everything forward and issue this frame's sweeps
+	Integrate(DeltaTime);
+
+	SET_DWORD_STAT(STAT_BatchedProjectilesLive, GetNumProjectiles());
+}
+
+TStatId UProjectileBatchSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileBatchSubsystem, STATGROUP_Tickables);
+}
+
+uint16 UProjectileBatchSubsystem::FindOrAddType(const FBatchedProjectileParams& Params)
+{
+	const int32 Existing = Types.IndexOfByPredicate([&Params](const FBatchedProjectileType& Type)
+	{
+		return Type.PhysicsForce == Params.PhysicsForce
+			&& Type.Restitution == Params.Restitution
+			&& Type.Friction == Params.Friction
+			&& Type.MaxLifetime == Params.MaxLifetime
+			&& Type.DamageType == Params.DamageType
+			&& Type.ImpactActorClass == Params.ImpactActorClass;
+	});
+
+	if (Existing != INDEX_NONE)
+	{
+		return static_cast<uint16>(Existing);
+	}
+
+	FBatchedProjectileType& Type = Types.AddDefaulted_GetRef();
+	Type.PhysicsForce = Params.PhysicsForce;
+	Type.Restitution = Params.Restitution;
+	Type.Friction = Params.Friction;
+	Type.MaxLifetime = Params.MaxLifetime;
+	Type.DamageType = Params.DamageType ? Params.DamageType : TSubclassOf<UDamageType>(UDamageType::StaticClass());
+	Type.ImpactActorClass = Params.ImpactActorClass;
+
+	return static_cast<uint16>(Types.Num() - 1);
+}
+
+void UProjectileBatchSubsystem::ResolveSweeps(TBitArray<>& OutRemove)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BatchedProjectilesResolve);
+
+	UWorld* World = GetWorld();
+
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		// expire projectiles that flew for too long
+		if (Ages[Index] > Types[TypeIndices[Index]].MaxLifetime)
+		{
+			OutRemove[Index] = true;
+			continue;
+		}
+
+		FTraceDatum Datum;
+		if (!PendingSweeps[Index].IsValid() || !World->QueryTraceData(PendingSweeps[Index], Datum))
+		{
+			continue;
+		}
+
+		PendingSweeps[Index].Invalidate();
+
+		// single sweeps return at most the blocking hit
+		if (Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit)
+		{
+			const FHitResult& Hit = Datum.OutHits[0];
+
+			ResolveImpact(Hit, Velocities[Index], Damages[Index], TypeIndices[Index], Owners[Index].Get(), !Impacted[Index]);
+			Impacted[Index] = true;
+
+			if (BouncesLeft[Index] > 0)
+			{
+				// bounce off the surface from where the sweep stopped
+				const FBatchedProjectileType& Type = Types[TypeIndices[Index]];
+
+				--BouncesLeft[Index];
+				Positions[Index] = Hit.Location + Hit.ImpactNormal * UE_KINDA_SMALL_NUMBER;
+				Velocities[Index] = FProjectileBallistics::Bounce(Velocities[Index], Hit.ImpactNormal, Type.Restitution, Type.Friction);
+
+			} else {
+
+				OutRemove[Index] = true;
+			}
+		}
+	}
+}
+
+void UProjectileBatchSubsystem::ResolveImpact(const FHitResult& Hit, const FVector& Velocity, float Damage, uint16 TypeIndex, AActor* Owner, bool bFirstImpact)
+{
+	INC_DWORD_STAT(STAT_BatchedProjectileImpacts);
+
+	const FBatchedProjectileType& Type = Types[TypeIndex];
+	const FVector HitDirection = Velocity.GetSafeNormal();
+
+	// only the server applies damage and physics, and only once per projectile. Later bounces are cosmetic
+	if (bFirstImpact && GetWorld()->GetNetMode() != NM_Client)
+	{
+		if (AActor* HitActor = Hit.GetActor())
+		{
+			const APawn* InstigatorPawn = Cast<APawn>(Owner);
+			AController* InstigatorController = InstigatorPawn ? InstigatorPawn->GetController() : nullptr;
+
+			UGameplayStatics::ApplyPointDamage(HitActor, Damage, HitDirection, Hit, InstigatorController, Owner, Type.DamageType);
+		}
+
+		UPrimitiveComponent* HitComp = Hit.GetComponent();
+		if (HitComp && HitComp->IsSimulatingPhysics())
+		{
+			HitComp->AddImpulseAtLocation(HitDirection * Type.PhysicsForce, Hit.ImpactPoint);
+		}
+	}
+
+	// spawn the impact actor, if any
+	if (Type.ImpactActorClass)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.Owner = Owner;
+
+		GetWorld()->SpawnActor<AActor>(Type.ImpactActorClass, FTransform(Hit.ImpactNormal.Rotation(), Hit.ImpactPoint), SpawnParams);
+	}
+}
+
+void UProjectileBatchSubsystem::LaunchAsyncProjectile(const FBatchedProjectileParams& Params, const FTransform& LaunchTransform, AActor* Owner)
+{
+	const int32 Id = NextAsyncId++;
+
+	FAsyncProjectileLaunch& Launch = AsyncSimulation->GetProducerInputData_External()->Launches.AddDefaulted_GetRef();
+	Launch.Id = Id;
+	Launch.Position = LaunchTransform.GetLocation();
+	Launch.Velocity = LaunchTransform.GetRotation().GetForwardVector() * Params.Speed;
+	Launch.Radius = Params.Radius;
+	Launch.GravityZ = GetWorld()->GetGravityZ() * Params.GravityScale;
+	Launch.Drag = Params.DragCoefficient;
+	Launch.Restitution = Params.Restitution;
+	Launch.Friction = Params.Friction;
+	Launch.MaxLifetime = Params.MaxLifetime;
+	Launch.MaxBounces = static_cast<uint8>(FMath::Clamp(Params.MaxBounces, 0, MAX_uint8));
+
+	// ignore the shooter's root body
+	if (const UPrimitiveComponent* OwnerRoot = Owner ? Cast<UPrimitiveComponent>(Owner->GetRootComponent()) : nullptr)
+	{
+		if (const FBodyInstance* OwnerBody = OwnerRoot->GetBodyInstance())
+		{
+			Launch.IgnoredProxy = OwnerBody->GetPhysicsActorHandle();
+		}
+	}
+
+	FAsyncBatchedProjectile& Projectile = AsyncProjectiles.Add(Id);
+	Projectile.Damage = Params.Damage;
+	Projectile.TypeIndex = FindOrAddType(Params);
+	Projectile.Owner = Owner;
+}
+
+void UProjectileBatchSubsystem::ResolveAsyncEvents()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BatchedProjectilesResolve);
+
+	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+
+	while (Chaos::TSimCallbackOutputHandle<FAsyncProjectileOutput> Output = AsyncSimulation->PopFutureOutputData_External())
+	{
+		for (const FAsyncProjectileEvent& Event : Output->Events)
+		{
+			FAsyncBatchedProjectile* Projectile = AsyncProjectiles.Find(Event.Id);
+			if (!Projectile)
+			{
+				continue;
+			}
+
+			if (Event.bHit)
+			{
+				FHitResult Hit;
+				Hit.bBlockingHit = true;
+				Hit.Location = Hit.ImpactPoint = Event.Location;
+				Hit.Normal = Hit.ImpactNormal = Event.Normal;
+
+				// proxies that were destroyed since the physics step are no longer mapped to a component
+				if (UPrimitiveComponent* HitComp = PhysScene ? PhysScene->GetOwningComponent<UPrimitiveComponent>(Event.HitProxy) : nullptr)
+				{
+					Hit.Component = HitComp;
+					Hit.HitObjectHandle = FActorInstanceHandle(HitComp->GetOwner());
+				}
+
+				ResolveImpact(Hit, Event.Velocity, Projectile->Damage, Projectile->TypeIndex, Projectile->Owner.Get(), !Projectile->bImpacted);
+				Projectile->bImpacted = true;
+			}
+
+			if (Event.bRemoved)
+			{
+				AsyncProjectiles.Remove(Event.Id);
+			}
+		}
+	}
+}
+
+void UProjectileBatchSubsystem::RemoveProjectileAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Velocities.RemoveAtSwap(Index, EAllowShrinking::No);
+	Radii.RemoveAtSwap(Index, EAllowShrinking::No);
+	GravityZs.RemoveAtSwap(Index, EAllowShrinking::No);
+	Drags.RemoveAtSwap(Index, EAllowShrinking::No);
+	BouncesLeft.RemoveAtSwap(Index, EAllowShrinking::No);
+	Damages.RemoveAtSwap(Index, EAllowShrinking::No);
+	Impacted.RemoveAtSwap(Index, EAllowShrinking::No);
+	Ages.RemoveAtSwap(Index, EAllowShrinking::No);
+	TypeIndices.RemoveAtSwap(Index, EAllowShrinking::No);
+	Owners.RemoveAtSwap(Index, EAllowShrinking::No);
+	PendingSweeps.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+void UProjectileBatchSubsystem::Integrate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BatchedProjectilesIntegrate);
+
+	UWorld* World = GetWorld();
+	const int32 Count = Positions.Num();
+
+	// fixed steps keep trajectories identical regardless of the frame rate
+	const int32 Steps = FProjectileBallistics::ConsumeSteps(StepAccumulator, DeltaTime);
+
+	if (Steps == 0 || Count == 0)
+	{
+		return;
+	}
+
+	// keep the start points for the sweeps
+	TArray<FVector> Starts(Positions);
+
+	for (int32 Step = 0; Step < Steps; ++Step)
+	{
+		FProjectileBallistics::Step(Positions, Velocities, GravityZs, Drags);
+	}
+
+	const float SteppedTime = Steps * FProjectileBallistics::FixedStep;
+
+	for (float& Age : Ages)
+	{
+		Age += SteppedTime;
+	}
+
+	// sweep the whole frame's path as one batch. Results are read back next frame
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		// ignore the shooter
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BatchedProjectileSweep), false, Owners[Index].Get());
+
+		PendingSweeps[Index] = World->AsyncSweepByChannel(EAsyncTraceType::Single, Starts[Index], Positions[Index], FQuat::Identity, BatchedProjectileChannel, FCollisionShape::MakeSphere(Radii[Index]), QueryParams);
+	}
+}
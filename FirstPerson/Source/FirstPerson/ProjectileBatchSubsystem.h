@@ -0,0 +1,180 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ProjectileBatchSubsystem.generated.h"
+
+class UDamageType;
+class FAsyncProjectileSimCallback;
+
+/**
+ *  Launch parameters for a projectile simulated by the batch subsystem
+ *  Usually filled from the defaults of a projectile actor class
+ */
+USTRUCT(BlueprintType)
+struct FBatchedProjectileParams
+{
+	GENERATED_BODY()
+
+	/** Launch speed */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (Units = "cm/s"))
+	float Speed = 3000.0f;
+
+	/** Collision sphere radius */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (Units = "cm"))
+	float Radius = 1.0f;
+
+	/** Multiplier for world gravity */
+	UPROPERTY(EditAnywhere, Category="Projectile")
+	float GravityScale = 0.0f;
+
+	/** Quadratic air drag. Deceleration is this times the squared speed */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (ClampMin = 0, Units = "1/cm"))
+	float DragCoefficient = 0.0f;
+
+	/** Number of surfaces the projectile bounces off before it's removed */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (ClampMin = 0, ClampMax = 255))
+	int32 MaxBounces = 0;
+
+	/** Fraction of the velocity along the surface normal kept after a bounce */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (ClampMin = 0, ClampMax = 1))
+	float Restitution = 0.6f;
+
+	/** Fraction of the velocity along the surface lost on a bounce */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (ClampMin = 0, ClampMax = 1))
+	float Friction = 0.2f;
+
+	/** Damage applied on hit */
+	UPROPERTY(EditAnywhere, Category="Projectile")
+	float Damage = 0.0f;
+
+	/** Physics impulse applied on hit */
+	UPROPERTY(EditAnywhere, Category="Projectile")
+	float PhysicsForce = 0.0f;
+
+	/** Time after which the projectile expires without hitting anything */
+	UPROPERTY(EditAnywhere, Category="Projectile", meta = (Units = "s"))
+	float MaxLifetime = 10.0f;
+
+	/** Type of damage applied on hit */
+	UPROPERTY(EditAnywhere, Category="Projectile")
+	TSubclassOf<UDamageType> DamageType;
+
+	/** Optional actor spawned at the impact point for effects */
+	UPROPERTY(EditAnywhere, Category="Projectile")
+	TSubclassOf<AActor> ImpactActorClass;
+};
+
+/**
+ *  Data shared by every projectile launched with the same parameters
+ */
+struct FBatchedProjectileType
+{
+	float PhysicsForce = 0.0f;
+	float Restitution = 0.0f;
+	float Friction = 0.0f;
+	float MaxLifetime = 0.0f;
+	TSubclassOf<UDamageType> DamageType;
+	TSubclassOf<AActor> ImpactActorClass;
+};
+
+/**
+ *  Game thread data for a projectile simulated on the physics thread
+ */
+struct FAsyncBatchedProjectile
+{
+	float Damage = 0.0f;
+	uint16 TypeIndex = 0;
+	TWeakObjectPtr<AActor> Owner;
+
+	/** Set once the projectile hit something. Bounces after the first hit don't apply damage again */
+	bool bImpacted = false;
+};
+
+/**
+ *  World subsystem that simulates projectiles without actors
+ *  Keeps in-flight projectiles in structure-of-arrays form, steps them together with the fixed step
+ *  ballistics kernel and issues their collision sweeps as one batch of async traces.
+ *  Actors are only spawned for impacts.
+ *  With FirstPerson.BatchedProjectiles.AsyncPhysics set, stepping and collision queries move to the
+ *  physics thread instead, and only the impacts are resolved on the game thread.
+ */
+UCLASS()
+class FIRSTPERSON_API UProjectileBatchSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Per projectile state. All arrays are kept in lockstep */
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> Radii;
+	TArray<float> GravityZs;
+	TArray<float> Drags;
+	TArray<uint8> BouncesLeft;
+	TArray<float> Damages;
+	TArray<bool> Impacted;
+	TArray<float> Ages;
+	TArray<uint16> TypeIndices;
+	TArray<TWeakObjectPtr<AActor>> Owners;
+	TArray<FTraceHandle> PendingSweeps;
+
+	/** Shared projectile types */
+	TArray<FBatchedProjectileType> Types;
+
+	/** Frame time not yet consumed by fixed steps */
+	float StepAccumulator = 0.0f;
+
+	/** Physics thread simulation, if enabled for this world */
+	FAsyncProjectileSimCallback* AsyncSimulation = nullptr;
+
+	/** Projectiles on the physics thread, by launch id */
+	TMap<int32, FAsyncBatchedProjectile> AsyncProjectiles;
+
+	/** Id given to the next projectile launched on the physics thread */
+	int32 NextAsyncId = 0;
+
+public:
+
+	/** Adds a projectile to the simulation */
+	void LaunchProjectile(const FBatchedProjectileParams& Params, const FTransform& LaunchTransform, AActor* Owner);
+
+	/** Returns the number of projectiles in flight */
+	UFUNCTION(BlueprintPure, Category="Projectile")
+	int32 GetNumProjectiles() const { return Positions.Num() + AsyncProjectiles.Num(); }
+
+	//~Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	//~End UWorldSubsystem interface
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+
+protected:
+
+	/** Finds or adds a type for the given params */
+	uint16 FindOrAddType(const FBatchedProjectileParams& Params);
+
+	/** Reads back last frame's sweeps and resolves impacts. Flags the projectiles that should be removed */
+	void ResolveSweeps(TBitArray<>& OutRemove);
+
+	/** Spawns the impact actor for a projectile hit. Damage and physics are only applied on the projectile's first hit, like projectile actors */
+	void ResolveImpact(const FHitResult& Hit, const FVector& Velocity, float Damage, uint16 TypeIndex, AActor* Owner, bool bFirstImpact);
+
+	/** Hands a projectile over to the physics thread simulation */
+	void LaunchAsyncProjectile(const FBatchedProjectileParams& Params, const FTransform& LaunchTransform, AActor* Owner);
+
+	/** Reads back the hits and expiries produced by the physics thread since the last frame */
+	void ResolveAsyncEvents();
+
+	/** Removes a projectile from every array */
+	void RemoveProjectileAtSwap(int32 Index);
+
+	/** Steps every projectile by this frame's fixed steps and issues the sweeps */
+	void Integrate(float DeltaTime);
+};
@@ -0,0 +1,189 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectileFireEventComponent.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "ProjectilePoolSubsystem.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Events Sent"), STAT_FireEventsSent, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Events Received"), STAT_FireEventsReceived, STATGROUP_FirstPerson);
+
+void FProjectileFireEvent::PostReplicatedAdd(const FProjectileFireEventArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->SimulateFireEvent(*this);
+	}
+}
+
+void FProjectileFireEvent::PostReplicatedChange(const FProjectileFireEventArray& InArraySerializer)
+{
+	// slots only change when a newer shot overwrites them
+	PostReplicatedAdd(InArraySerializer);
+}
+
+UProjectileFireEventComponent::UProjectileFireEventComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UProjectileFireEventComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	// let the fast array call back into this component
+	FireEvents.OwnerComponent = this;
+}
+
+void UProjectileFireEventComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UProjectileFireEventComponent, FireEvents);
+}
+
+bool UProjectileFireEventComponent::CanFireProjectile(TSubclassOf<AActor> ProjectileClass) const
+{
+	const int32 TypeId = ProjectileTypes.IndexOfByKey(ProjectileClass);
+	return ProjectileClass && TypeId != INDEX_NONE && TypeId <= MAX_uint8;
+}
+
+AActor* UProjectileFireEventComponent::FireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, APawn* ProjectileInstigator)
+{
+	// only the server records shots
+	if (!GetOwner()->HasAuthority() || !CanFireProjectile(ProjectileClass))
+	{
+		return nullptr;
+	}
+
+	AActor* Projectile = AcquireProjectile(ProjectileClass, SpawnTransform, ProjectileInstigator);
+
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	RecordFireEvent(ProjectileClass, SpawnTransform);
+
+	return Projectile;
+}
+
+bool UProjectileFireEventComponent::RecordFireEvent(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform)
+{
+	// only the server records shots
+	if (!GetOwner()->HasAuthority() || !CanFireProjectile(ProjectileClass))
+	{
+		return false;
+	}
+
+	// fill the ring buffer, then overwrite the oldest shot in place so only that one item is sent
+	if (NextEventIndex >= MaxBufferedEvents)
+	{
+		NextEventIndex = 0;
+	}
+
+	if (!FireEvents.Items.IsValidIndex(NextEventIndex))
+	{
+		FireEvents.Items.AddDefaulted();
+		NextEventIndex = FireEvents.Items.Num() - 1;
+	}
+
+	FProjectileFireEvent& FireEvent = FireEvents.Items[NextEventIndex++];
+	FireEvent.Origin = SpawnTransform.GetLocation();
+	FireEvent.PackedDirection = PackDirection(SpawnTransform.GetRotation().GetForwardVector());
+	FireEvent.ProjectileTypeId = static_cast<uint8>(ProjectileTypes.IndexOfByKey(ProjectileClass));
+	FireEvent.ServerTime = GetWorld()->GetTimeSeconds();
+	FireEvent.RandomSeed = FMath::Rand();
+
+	FireEvents.MarkItemDirty(FireEvent);
+
+	INC_DWORD_STAT(STAT_FireEventsSent);
+
+	return true;
+}
+
+void UProjectileFireEventComponent::SimulateFireEvent(const FProjectileFireEvent& FireEvent)
+{
+	// the server already spawned the authoritative projectile
+	if (GetOwner()->HasAuthority() || !ProjectileTypes.IsValidIndex(FireEvent.ProjectileTypeId))
+	{
+		return;
+	}
+
+	const TSubclassOf<AActor> ProjectileClass = ProjectileTypes[FireEvent.ProjectileTypeId];
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	// find out how long ago the shot was fired
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const float EventAge = GameState ? FMath::Max(0.0f, static_cast<float>(GameState->GetServerWorldTimeSeconds() - FireEvent.ServerTime)) : 0.0f;
+
+	// don't replay old shots, e.g. the backlog received when the shooter becomes relevant
+	if (EventAge > MaxEventAge)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_FireEventsReceived);
+
+	const FVector Direction = UnpackDirection(FireEvent.PackedDirection);
+
+	AActor* Projectile = AcquireProjectile(ProjectileClass, FTransform(Direction.Rotation(), FireEvent.Origin), Cast<APawn>(GetOwner()));
+
+	if (!Projectile)
+	{
+		return;
+	}
+
+	// catch up with the authoritative projectile. Sweep so we still hit anything along the way
+	if (const UProjectileMovementComponent* Movement = Projectile->FindComponentByClass<UProjectileMovementComponent>())
+	{
+		Projectile->SetActorLocation(FVector(FireEvent.Origin) + Direction * Movement->InitialSpeed * EventAge, true);
+	}
+
+	OnCosmeticProjectileFired.Broadcast(Projectile, FireEvent.RandomSeed);
+}
+
+uint32 UProjectileFireEventComponent::PackDirection(const FVector& Direction)
+{
+	const FRotator Rotation = Direction.Rotation();
+	return (static_cast<uint32>(FRotator::CompressAxisToShort(Rotation.Yaw)) << 16) | FRotator::CompressAxisToShort(Rotation.Pitch);
+}
+
+FVector UProjectileFireEventComponent::UnpackDirection(uint32 PackedDirection)
+{
+	const float Pitch = FRotator::DecompressAxisFromShort(static_cast<uint16>(PackedDirection & 0xFFFF));
+	const float Yaw = FRotator::DecompressAxisFromShort(static_cast<uint16>(PackedDirection >> 16));
+	return FRotator(Pitch, Yaw, 0.0f).Vector();
+}
+
+AActor* UProjectileFireEventComponent::AcquireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, APawn* ProjectileInstigator) const
+{
+	if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		return ProjectilePool->AcquireProjectile(ProjectileClass, SpawnTransform, GetOwner(), ProjectileInstigator, true);
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.Owner = GetOwner();
+	SpawnParams.Instigator = ProjectileInstigator;
+
+	AActor* Projectile = GetWorld()->SpawnActor<AActor>(ProjectileClass, SpawnTransform, SpawnParams);
+
+	if (Projectile)
+	{
+		Projectile->SetReplicates(false);
+	}
+
+	return Projectile;
+}
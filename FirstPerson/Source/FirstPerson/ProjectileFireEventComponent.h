@@ -0,0 +1,153 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "ProjectileFireEventComponent.generated.h"
+
+class UProjectileFireEventComponent;
+struct FProjectileFireEventArray;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnCosmeticProjectileFired, AActor*, Projectile, int32, RandomSeed);
+
+/**
+ *  A single shot, replicated instead of the projectile actor
+ */
+USTRUCT()
+struct FProjectileFireEvent : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Spawn location of the projectile */
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	/** Shot direction, yaw and pitch compressed to 16 bits each */
+	UPROPERTY()
+	uint32 PackedDirection = 0;
+
+	/** Index of the projectile class in the component's projectile types */
+	UPROPERTY()
+	uint8 ProjectileTypeId = 0;
+
+	/** Server time the shot was fired at */
+	UPROPERTY()
+	float ServerTime = 0.0f;
+
+	/** Seed for any cosmetic randomness, so every client plays the same variation */
+	UPROPERTY()
+	int32 RandomSeed = 0;
+
+	/** Spawns the cosmetic projectile on clients */
+	void PostReplicatedAdd(const FProjectileFireEventArray& InArraySerializer);
+
+	/** Spawns the cosmetic projectile on clients once the server overwrites this slot of the ring buffer with a newer shot */
+	void PostReplicatedChange(const FProjectileFireEventArray& InArraySerializer);
+};
+
+/**
+ *  Fast array of the most recent shots
+ */
+USTRUCT()
+struct FProjectileFireEventArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	/** Ring buffer of the most recent shots. Once it's full, new shots overwrite the oldest one in place */
+	UPROPERTY()
+	TArray<FProjectileFireEvent> Items;
+
+	/** Component that owns this array. Not a property so it's never copied from the archetype */
+	UProjectileFireEventComponent* OwnerComponent = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FProjectileFireEvent, FProjectileFireEventArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileFireEventArray> : public TStructOpsTypeTraitsBase2<FProjectileFireEventArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ *  Replicates shots as compact fire events instead of replicated projectile actors
+ *  Add it to a shooter to opt in. The server spawns a non-replicated authoritative projectile that resolves hits,
+ *  while clients simulate a cosmetic copy from the replicated event.
+ */
+UCLASS(ClassGroup=(FirstPerson), meta=(BlueprintSpawnableComponent))
+class FIRSTPERSON_API UProjectileFireEventComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Projectile classes that can be sent as fire events. The index in this list is the replicated type id */
+	UPROPERTY(EditAnywhere, Category="Fire Events")
+	TArray<TSubclassOf<AActor>> ProjectileTypes;
+
+	/** Number of shots kept in the replicated buffer */
+	UPROPERTY(EditAnywhere, Category="Fire Events", meta = (ClampMin = 1, ClampMax = 128))
+	int32 MaxBufferedEvents = 32;
+
+	/** Events older than this are ignored by clients, e.g. when the shooter first becomes relevant */
+	UPROPERTY(EditAnywhere, Category="Fire Events", meta = (ClampMin = 0, Units = "s"))
+	float MaxEventAge = 0.5f;
+
+	/** Replicated shots */
+	UPROPERTY(Replicated)
+	FProjectileFireEventArray FireEvents;
+
+	/** Slot of the ring buffer the next shot is written to. Server only */
+	int32 NextEventIndex = 0;
+
+public:
+
+	/** Called on clients when a cosmetic projectile is spawned from a fire event */
+	UPROPERTY(BlueprintAssignable, Category="Fire Events")
+	FOnCosmeticProjectileFired OnCosmeticProjectileFired;
+
+	/** Constructor */
+	UProjectileFireEventComponent();
+
+	//~Begin UActorComponent interface
+	virtual void OnRegister() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	//~End UActorComponent interface
+
+	/** Returns true if the given projectile class has a type id and can be sent as a fire event */
+	bool CanFireProjectile(TSubclassOf<AActor> ProjectileClass) const;
+
+	/**
+	 *  Server only. Spawns a non-replicated authoritative projectile and records the shot for clients
+	 *  Returns nullptr if the class can't be sent as a fire event, so the caller can fall back to a replicated projectile
+	 */
+	AActor* FireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, APawn* ProjectileInstigator);
+
+	/**
+	 *  Server only. Records a shot for clients to simulate, without spawning an authoritative projectile
+	 *  Used for shots the server resolves some other way, e.g. in the projectile batch. Returns false if the class can't be sent
+	 */
+	bool RecordFireEvent(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform);
+
+	/** Spawns the cosmetic projectile for a replicated fire event */
+	void SimulateFireEvent(const FProjectileFireEvent& FireEvent);
+
+	/** Compresses a direction to yaw and pitch shorts */
+	static uint32 PackDirection(const FVector& Direction);
+
+	/** Expands a compressed direction */
+	static FVector UnpackDirection(uint32 PackedDirection);
+
+protected:
+
+	/** Spawns or takes a projectile from the pool. Clients simulate their own copy from the fire event, so it never replicates */
+	AActor* AcquireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, APawn* ProjectileInstigator) const;
+};
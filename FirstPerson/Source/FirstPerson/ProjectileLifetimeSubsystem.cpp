@@ -0,0 +1,206 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectileLifetimeSubsystem.h"
+#include "ProjectilePoolSubsystem.h"
+#include "PooledProjectile.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/LevelBounds.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Lifetime Update"), STAT_ProjectileLifetimeUpdate, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles Live"), STAT_ProjectilesLive, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Expired"), STAT_ProjectilesExpired, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Left Bounds"), STAT_ProjectilesLeftBounds, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Evicted"), STAT_ProjectilesEvicted, STATGROUP_FirstPerson);
+
+static TAutoConsoleVariable<int32> CVarProjectileMaxLive(
+	TEXT("FirstPerson.ProjectileLifetime.MaxLive"),
+	256,
+	TEXT("Max number of pooled projectiles in flight. The oldest ones are taken back first"));
+
+static TAutoConsoleVariable<float> CVarProjectileBoundsMargin(
+	TEXT("FirstPerson.ProjectileLifetime.BoundsMargin"),
+	2000.0f,
+	TEXT("Distance outside the level bounds a projectile may travel before it's taken back"));
+
+void UProjectileLifetimeSubsystem::TrackProjectile(AActor* Projectile)
+{
+	const IPooledProjectile* Pooled = Cast<IPooledProjectile>(Projectile);
+	if (!Pooled)
+	{
+		return;
+	}
+
+	// make room by taking back the oldest projectiles
+	const int32 MaxLive = FMath::Max(1, CVarProjectileMaxLive.GetValueOnGameThread());
+
+	while (NumLive >= MaxLive && OldestIndex < TrackedProjectiles.Num())
+	{
+		FTrackedProjectile& Tracked = TrackedProjectiles[OldestIndex++];
+
+		if (!Tracked.Projectile.IsExplicitlyNull())
+		{
+			AActor* Oldest = Tracked.Projectile.Get();
+			ClearEntry(Tracked);
+
+			if (Oldest)
+			{
+				INC_DWORD_STAT(STAT_ProjectilesEvicted);
+				++NumExpired;
+
+				UProjectilePoolSubsystem::ReleaseOrDestroy(Oldest);
+			}
+		}
+	}
+
+	// a projectile handed out again without being released only keeps its newest entry
+	UntrackProjectile(Projectile);
+
+	CompactEntries();
+
+	const FProjectileFlightLimits Limits = Pooled->GetFlightLimits();
+
+	TrackedIndices.Add(Projectile, TrackedProjectiles.Num());
+
+	FTrackedProjectile& Tracked = TrackedProjectiles.AddDefaulted_GetRef();
+	Tracked.Projectile = Projectile;
+	Tracked.LaunchLocation = Projectile->GetActorLocation();
+	Tracked.LaunchTime = GetWorld()->GetTimeSeconds();
+	Tracked.MaxFlightTime = Limits.MaxFlightTime;
+	Tracked.MaxFlightRangeSquared = FMath::Square(Limits.MaxFlightRange);
+
+	++NumLive;
+}
+
+void UProjectileLifetimeSubsystem::UntrackProjectile(AActor* Projectile)
+{
+	// clear in place so the front stays the oldest without shifting the array
+	if (const int32* Index = TrackedIndices.Find(Projectile))
+	{
+		ClearEntry(TrackedProjectiles[*Index]);
+	}
+}
+
+void UProjectileLifetimeSubsystem::ClearEntry(FTrackedProjectile& Tracked)
+{
+	TrackedIndices.Remove(Tracked.Projectile);
+	Tracked.Projectile.Reset();
+	--NumLive;
+}
+
+void UProjectileLifetimeSubsystem::CompactEntries()
+{
+	// amortized, so tracking stays constant time on average
+	if (TrackedProjectiles.Num() - NumLive <= FMath::Max(16, TrackedProjectiles.Num() / 2))
+	{
+		return;
+	}
+
+	TrackedProjectiles.RemoveAll([](const FTrackedProjectile& Tracked) { return Tracked.Projectile.IsExplicitlyNull(); });
+	OldestIndex = 0;
+
+	for (int32 Index = 0; Index < TrackedProjectiles.Num(); ++Index)
+	{
+		TrackedIndices.Add(TrackedProjectiles[Index].Projectile, Index);
+	}
+}
+
+void UProjectileLifetimeSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// calculate the level bounds once. Streamed in levels are expected to stay inside the persistent level's box
+	if (InWorld.PersistentLevel)
+	{
+		LevelBounds = ALevelBounds::CalculateLevelBounds(InWorld.PersistentLevel);
+	}
+
+	if (LevelBounds.IsValid)
+	{
+		LevelBounds = LevelBounds.ExpandBy(CVarProjectileBoundsMargin.GetValueOnGameThread());
+	}
+}
+
+void UProjectileLifetimeSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileLifetimeUpdate);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const AWorldSettings* WorldSettings = GetWorld()->GetWorldSettings();
+	const float KillZ = WorldSettings && WorldSettings->bEnableWorldBoundsChecks ? WorldSettings->KillZ : -UE_BIG_NUMBER;
+
+	// collect the expired projectiles first. Releasing them calls back into UntrackProjectile
+	TArray<AActor*, TInlineAllocator<16>> Expired;
+
+	for (int32 Index = OldestIndex; Index < TrackedProjectiles.Num(); ++Index)
+	{
+		FTrackedProjectile& Tracked = TrackedProjectiles[Index];
+
+		if (Tracked.Projectile.IsExplicitlyNull())
+		{
+			continue;
+		}
+
+		AActor* Projectile = Tracked.Projectile.Get();
+
+		// forget projectiles that were destroyed behind our back
+		if (!Projectile)
+		{
+			ClearEntry(Tracked);
+			continue;
+		}
+
+		if (HasExpired(Tracked, Projectile, Now, KillZ))
+		{
+			Expired.Add(Projectile);
+		}
+	}
+
+	for (AActor* Projectile : Expired)
+	{
+		++NumExpired;
+		INC_DWORD_STAT(STAT_ProjectilesExpired);
+
+		UntrackProjectile(Projectile);
+		UProjectilePoolSubsystem::ReleaseOrDestroy(Projectile);
+	}
+
+	CompactEntries();
+
+	SET_DWORD_STAT(STAT_ProjectilesLive, NumLive);
+}
+
+TStatId UProjectileLifetimeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileLifetimeSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectileLifetimeSubsystem::HasExpired(const FTrackedProjectile& Tracked, const AActor* Projectile, double Now, float KillZ) const
+{
+	// flew for too long?
+	if (Now - Tracked.LaunchTime > Tracked.MaxFlightTime)
+	{
+		return true;
+	}
+
+	const FVector Location = Projectile->GetActorLocation();
+
+	// flew too far?
+	if (FVector::DistSquared(Location, Tracked.LaunchLocation) > Tracked.MaxFlightRangeSquared)
+	{
+		return true;
+	}
+
+	// left the level?
+	if (Location.Z < KillZ || (LevelBounds.IsValid && !LevelBounds.IsInside(Location)))
+	{
+		INC_DWORD_STAT(STAT_ProjectilesLeftBounds);
+		return true;
+	}
+
+	return false;
+}
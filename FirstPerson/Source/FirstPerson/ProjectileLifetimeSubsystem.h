@@ -0,0 +1,96 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileLifetimeSubsystem.generated.h"
+
+/**
+ *  A projectile in flight, as seen by the lifetime manager
+ */
+struct FTrackedProjectile
+{
+	/** Projectile in flight */
+	TWeakObjectPtr<AActor> Projectile;
+
+	/** Where it was launched from */
+	FVector LaunchLocation = FVector::ZeroVector;
+
+	/** World time it was launched at */
+	double LaunchTime = 0.0;
+
+	/** Flight time after which it expires */
+	float MaxFlightTime = 0.0f;
+
+	/** Squared distance from the launch location after which it expires */
+	float MaxFlightRangeSquared = 0.0f;
+};
+
+/**
+ *  Projectile lifetime manager
+ *  Takes pooled projectiles back once they exceed their class's max flight time or range, or leave the level bounds.
+ *  Also caps the number of live projectiles, evicting the oldest ones first.
+ */
+UCLASS()
+class FIRSTPERSON_API UProjectileLifetimeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/**
+	 *  Projectiles in flight, oldest first
+	 *  Untracked and evicted entries are cleared in place instead of shifting the array, and compacted once they pile up
+	 */
+	TArray<FTrackedProjectile> TrackedProjectiles;
+
+	/** Entry index of every tracked projectile, so untracking doesn't have to search the array */
+	TMap<TWeakObjectPtr<AActor>, int32> TrackedIndices;
+
+	/** Index of the oldest entry that may still be in use */
+	int32 OldestIndex = 0;
+
+	/** Number of projectiles in flight */
+	int32 NumLive = 0;
+
+	/** Bounds of the persistent level, expanded by a margin */
+	FBox LevelBounds = FBox(ForceInit);
+
+	/** Projectiles taken back by the manager since the world started */
+	int32 NumExpired = 0;
+
+public:
+
+	/** Starts tracking a projectile that was just launched. Evicts the oldest projectile if we're at the cap */
+	void TrackProjectile(AActor* Projectile);
+
+	/** Stops tracking a projectile, e.g. because it was returned to the pool. Constant time */
+	void UntrackProjectile(AActor* Projectile);
+
+	/** Returns the number of projectiles in flight */
+	UFUNCTION(BlueprintPure, Category="Projectile")
+	int32 GetNumLiveProjectiles() const { return NumLive; }
+
+	/** Returns the number of projectiles taken back by the manager since the world started */
+	UFUNCTION(BlueprintPure, Category="Projectile")
+	int32 GetNumExpiredProjectiles() const { return NumExpired; }
+
+	//~Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~End UWorldSubsystem interface
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+
+protected:
+
+	/** Returns true if the projectile has outlived its limits */
+	bool HasExpired(const FTrackedProjectile& Tracked, const AActor* Projectile, double Now, float KillZ) const;
+
+	/** Clears an entry in place */
+	void ClearEntry(FTrackedProjectile& Tracked);
+
+	/** Removes the cleared entries once they make up most of the array. Keeps the order and updates the indices */
+	void CompactEntries();
+};
@@ -0,0 +1,241 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectilePoolSubsystem.h"
+#include "PooledProjectile.h"
+#include "ProjectileLifetimeSubsystem.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_ProjectilePoolHits, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_ProjectilePoolMisses, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool Active"), STAT_ProjectilePoolActive, STATGROUP_FirstPerson);
+
+void UProjectilePoolSubsystem::Deinitialize()
+{
+	// log the pool usage so pools can be sized per map
+	for (const TPair<TObjectPtr<UClass>, FProjectilePool>& Pair : Pools)
+	{
+		const FProjectilePoolStats& Stats = Pair.Value.Stats;
+		UE_LOG(LogFirstPerson, Log, TEXT("Projectile pool %s: %d hits, %d misses, high water %d"), *GetNameSafe(Pair.Key), Stats.Hits, Stats.Misses, Stats.HighWater);
+	}
+
+	for (const TPair<TObjectPtr<UClass>, FProjectilePool>& Pair : LocalPools)
+	{
+		const FProjectilePoolStats& Stats = Pair.Value.Stats;
+		UE_LOG(LogFirstPerson, Log, TEXT("Local projectile pool %s: %d hits, %d misses, high water %d"), *GetNameSafe(Pair.Key), Stats.Hits, Stats.Misses, Stats.HighWater);
+	}
+
+	Pools.Empty();
+	LocalPools.Empty();
+
+	Super::Deinitialize();
+}
+
+void UProjectilePoolSubsystem::PrewarmPool(TSubclassOf<AActor> ProjectileClass, int32 Count)
+{
+	// only projectiles that know how to reset themselves can be pooled
+	if (!ProjectileClass || !ProjectileClass->ImplementsInterface(UPooledProjectile::StaticClass()))
+	{
+		return;
+	}
+
+	FProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass.Get());
+
+	while (Pool.Inactive.Num() < Count)
+	{
+		AActor* Projectile = SpawnPooledProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr);
+
+		if (!Projectile)
+		{
+			break;
+		}
+
+		StoreProjectile(Pool, Projectile);
+	}
+}
+
+AActor* UProjectilePoolSubsystem::AcquireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, bool bLocalOnly)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	// non-poolable classes are spawned as usual
+	if (!ProjectileClass->ImplementsInterface(UPooledProjectile::StaticClass()))
+	{
+		return SpawnPooledProjectile(ProjectileClass, SpawnTransform, Owner, Instigator, bLocalOnly);
+	}
+
+	// classes that don't replicate anyway share one pool
+	bLocalOnly &= ProjectileClass->GetDefaultObject<AActor>()->GetIsReplicated();
+
+	FProjectilePool& Pool = FindOrAddPool(ProjectileClass, bLocalOnly);
+
+	AActor* Projectile = nullptr;
+
+	// reuse an inactive projectile if we have one
+	while (!Projectile && Pool.Inactive.Num() > 0)
+	{
+		AActor* Candidate = Pool.Inactive.Pop(EAllowShrinking::No);
+
+		// pooled actors can still be destroyed externally, e.g. by a level unload
+		if (IsValid(Candidate))
+		{
+			Projectile = Candidate;
+		}
+	}
+
+	if (Projectile)
+	{
+		++Pool.Stats.Hits;
+		INC_DWORD_STAT(STAT_ProjectilePoolHits);
+
+		// move the projectile into place and hand it to its new owner
+		Projectile->SetOwner(Owner);
+		Projectile->SetInstigator(Instigator);
+		Projectile->SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+
+		IPooledProjectile* PooledProjectile = Cast<IPooledProjectile>(Projectile);
+		PooledProjectile->bInPool = false;
+		PooledProjectile->OnAcquiredFromPool();
+
+	} else {
+
+		++Pool.Stats.Misses;
+		INC_DWORD_STAT(STAT_ProjectilePoolMisses);
+
+		Projectile = SpawnPooledProjectile(ProjectileClass, SpawnTransform, Owner, Instigator, bLocalOnly);
+
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+	}
+
+	// update the usage counters
+	++Pool.Stats.Active;
+	Pool.Stats.HighWater = FMath::Max(Pool.Stats.HighWater, Pool.Stats.Active);
+	INC_DWORD_STAT(STAT_ProjectilePoolActive);
+
+	// let the lifetime manager take the projectile back if it never hits anything
+	if (UProjectileLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UProjectileLifetimeSubsystem>())
+	{
+		Lifetime->TrackProjectile(Projectile);
+	}
+
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile(AActor* Projectile)
+{
+	if (!IsValid(Projectile))
+	{
+		return;
+	}
+
+	IPooledProjectile* PooledProjectile = Cast<IPooledProjectile>(Projectile);
+
+	// projectiles that can't reset themselves are just destroyed
+	if (!PooledProjectile)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	// ignore double releases
+	if (PooledProjectile->IsInPool())
+	{
+		return;
+	}
+
+	FProjectilePool& Pool = FindOrAddPool(Projectile->GetClass(), IsLocalOnly(Projectile));
+
+	Pool.Stats.Active = FMath::Max(0, Pool.Stats.Active - 1);
+	DEC_DWORD_STAT(STAT_ProjectilePoolActive);
+
+	if (UProjectileLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UProjectileLifetimeSubsystem>())
+	{
+		Lifetime->UntrackProjectile(Projectile);
+	}
+
+	StoreProjectile(Pool, Projectile);
+}
+
+void UProjectilePoolSubsystem::ReleaseOrDestroy(AActor* Projectile)
+{
+	if (!IsValid(Projectile))
+	{
+		return;
+	}
+
+	// only the server owns the lifetime of replicated projectiles
+	if (Projectile->GetIsReplicated() && !Projectile->HasAuthority())
+	{
+		return;
+	}
+
+	if (UProjectilePoolSubsystem* Pool = Projectile->GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		Pool->ReleaseProjectile(Projectile);
+
+	} else {
+
+		Projectile->Destroy();
+	}
+}
+
+FProjectilePoolStats UProjectilePoolSubsystem::GetPoolStats(TSubclassOf<AActor> ProjectileClass) const
+{
+	if (const FProjectilePool* Pool = Pools.Find(ProjectileClass.Get()))
+	{
+		return Pool->Stats;
+	}
+
+	return FProjectilePoolStats();
+}
+
+FProjectilePool& UProjectilePoolSubsystem::FindOrAddPool(UClass* ProjectileClass, bool bLocalOnly)
+{
+	return bLocalOnly ? LocalPools.FindOrAdd(ProjectileClass) : Pools.FindOrAdd(ProjectileClass);
+}
+
+bool UProjectilePoolSubsystem::IsLocalOnly(const AActor* Projectile)
+{
+	return !Projectile->GetIsReplicated() && Projectile->GetClass()->GetDefaultObject<AActor>()->GetIsReplicated();
+}
+
+AActor* UProjectilePoolSubsystem::SpawnPooledProjectile(UClass* ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, bool bLocalOnly) const
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
+	SpawnParams.Owner = Owner;
+	SpawnParams.Instigator = Instigator;
+
+	AActor* Projectile = GetWorld()->SpawnActor<AActor>(ProjectileClass, SpawnTransform, SpawnParams);
+
+	// turned off before the first net update, so it never opens an actor channel
+	if (Projectile && bLocalOnly)
+	{
+		Projectile->SetReplicates(false);
+	}
+
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::StoreProjectile(FProjectilePool& Pool, AActor* Projectile)
+{
+	// let the projectile stop movement and disable its collision
+	IPooledProjectile* PooledProjectile = Cast<IPooledProjectile>(Projectile);
+	PooledProjectile->bInPool = true;
+	PooledProjectile->OnReturnedToPool();
+
+	// drop the references to the previous shooter
+	Projectile->SetOwner(nullptr);
+	Projectile->SetInstigator(nullptr);
+
+	Pool.Inactive.Add(Projectile);
+}
@@ -0,0 +1,115 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class APawn;
+
+/**
+ *  Usage counters for a single projectile pool
+ */
+USTRUCT(BlueprintType)
+struct FProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	/** Number of acquisitions served from an already pooled projectile */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Hits = 0;
+
+	/** Number of acquisitions that had to spawn a new projectile */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Misses = 0;
+
+	/** Number of projectiles currently handed out */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Active = 0;
+
+	/** Highest number of projectiles handed out at the same time */
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 HighWater = 0;
+};
+
+/**
+ *  Pooled projectiles of a single class
+ */
+USTRUCT()
+struct FProjectilePool
+{
+	GENERATED_BODY()
+
+	/** Projectiles waiting to be handed out */
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> Inactive;
+
+	/** Usage counters for this pool */
+	FProjectilePoolStats Stats;
+};
+
+/**
+ *  World subsystem that recycles projectile actors
+ *  Pre-warms a pool per projectile class and hands projectiles out and takes them back,
+ *  so firing doesn't construct and tear down replicated actors every shot.
+ *  Projectile classes opt in by implementing IPooledProjectile.
+ */
+UCLASS()
+class FIRSTPERSON_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Pools by projectile class */
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FProjectilePool> Pools;
+
+	/** Pools of replicated projectile classes handed out with replication turned off, e.g. for fire events */
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FProjectilePool> LocalPools;
+
+public:
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Spawns projectiles of the given class until at least Count of them are waiting in the pool */
+	void PrewarmPool(TSubclassOf<AActor> ProjectileClass, int32 Count);
+
+	/**
+	 *  Hands out a projectile of the given class at the given transform, spawning one if the pool is empty
+	 *  Local only projectiles don't replicate and come from their own pool, so the class's replicated pool never hands them out
+	 */
+	AActor* AcquireProjectile(TSubclassOf<AActor> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, bool bLocalOnly = false);
+
+	/** Typed version of AcquireProjectile */
+	template<class T>
+	T* AcquireProjectile(TSubclassOf<T> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, bool bLocalOnly = false)
+	{
+		return Cast<T>(AcquireProjectile(TSubclassOf<AActor>(ProjectileClass.Get()), SpawnTransform, Owner, Instigator, bLocalOnly));
+	}
+
+	/** Takes a projectile back into its pool. Projectiles that can't be pooled are destroyed instead */
+	void ReleaseProjectile(AActor* Projectile);
+
+	/** Releases the projectile into its world's pool if there is one, otherwise destroys it */
+	static void ReleaseOrDestroy(AActor* Projectile);
+
+	/** Returns the usage counters for the given projectile class */
+	UFUNCTION(BlueprintPure, Category="Projectile Pool")
+	FProjectilePoolStats GetPoolStats(TSubclassOf<AActor> ProjectileClass) const;
+
+protected:
+
+	/** Returns the pool for the given class, and whether its projectiles replicate */
+	FProjectilePool& FindOrAddPool(UClass* ProjectileClass, bool bLocalOnly);
+
+	/** Returns true if the projectile is a replicated class with replication turned off, and so belongs in the local pools */
+	static bool IsLocalOnly(const AActor* Projectile);
+
+	/** Spawns a new projectile for the given pool */
+	AActor* SpawnPooledProjectile(UClass* ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, bool bLocalOnly = false) const;
+
+	/** Deactivates a projectile and adds it to the inactive list of its pool */
+	void StoreProjectile(FProjectilePool& Pool, AActor* Projectile);
+};
@@ -0,0 +1,300 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProximityTriggerSubsystem.h"
+#include "FirstPerson.h"
+#include "FirstPersonCharacter.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Proximity Triggers Update"), STAT_ProximityTriggersUpdate, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Proximity Triggers"), STAT_ProximityTriggers, STATGROUP_FirstPerson);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Proximity Trigger Tests"), STAT_ProximityTriggerTests, STATGROUP_FirstPerson);
+
+static TAutoConsoleVariable<float> CVarProximityCellSize(
+	TEXT("FirstPerson.Proximity.CellSize"),
+	1000.0f,
+	TEXT("Size in cm of the spatial hash cells proximity triggers are bucketed in"));
+
+/** Largest pawn collision radius considered. Triggers reach this much further into neighbouring cells */
+static constexpr float MaxPawnRadius = 100.0f;
+
+int32 UProximityTriggerSubsystem::RegisterTrigger(AActor* Owner, const FProximityTriggerParams& Params)
+{
+	FProximityTrigger Trigger;
+	Trigger.Params = Params;
+	Trigger.Owner = Owner;
+	Trigger.Location = Owner->GetActorLocation() + Params.Offset;
+	Trigger.Generation = ++NextGeneration;
+
+	const int32 Handle = Triggers.Add(MoveTemp(Trigger));
+	AddToCells(Handle);
+
+	return Handle;
+}
+
+void UProximityTriggerSubsystem::UnregisterTrigger(int32 Handle)
+{
+	if (!Triggers.IsValidIndex(Handle))
+	{
+		return;
+	}
+
+	RemoveFromCells(Handle);
+	OccupiedTriggers.Remove(Handle);
+	Triggers.RemoveAt(Handle);
+}
+
+void UProximityTriggerSubsystem::SetTriggerEnabled(int32 Handle, bool bEnabled)
+{
+	if (Triggers.IsValidIndex(Handle))
+	{
+		FProximityTrigger& Trigger = Triggers[Handle];
+		Trigger.bEnabled = bEnabled;
+
+		// forget who was inside, so they enter again once it's back on
+		if (!bEnabled)
+		{
+			Trigger.PawnsInside.Reset();
+			OccupiedTriggers.Remove(Handle);
+		}
+	}
+}
+
+void UProximityTriggerSubsystem::UpdateTriggerLocation(int32 Handle)
+{
+	if (!Triggers.IsValidIndex(Handle))
+	{
+		return;
+	}
+
+	FProximityTrigger& Trigger = Triggers[Handle];
+
+	if (const AActor* Owner = Trigger.Owner.Get())
+	{
+		RemoveFromCells(Handle);
+		Trigger.Location = Owner->GetActorLocation() + Trigger.Params.Offset;
+		AddToCells(Handle);
+	}
+}
+
+void UProximityTriggerSubsystem::RegisterPawn(APawn* Pawn)
+{
+	if (Pawn)
+	{
+		Pawns.AddUnique(Pawn);
+	}
+}
+
+void UProximityTriggerSubsystem::UnregisterPawn(APawn* Pawn)
+{
+	Pawns.RemoveSingleSwap(Pawn);
+}
+
+void UProximityTriggerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProximityTriggersUpdate);
+
+	SET_DWORD_STAT(STAT_ProximityTriggers, Triggers.Num());
+
+	if (Triggers.Num() == 0)
+	{
+		return;
+	}
+
+	// rebucket everything if the cell size was changed from the console
+	if (CellSize != FMath::Max(1.0f, CVarProximityCellSize.GetValueOnGameThread()))
+	{
+		RebuildCells();
+	}
+
+	// pawns inside each trigger this frame
+	TMap<int32, TArray<APawn*, TInlineAllocator<2>>> NowInside;
+
+	int32 NumTests = 0;
+
+	// drop pawns that are gone
+	Pawns.RemoveAllSwap([](const TWeakObjectPtr<APawn>& Pawn) { return !Pawn.IsValid(); });
+
+	for (const TWeakObjectPtr<APawn>& WeakPawn : Pawns)
+	{
+		APawn* Pawn = WeakPawn.Get();
+
+		if (!Pawn->IsPlayerControlled() || Pawn->IsActorBeingDestroyed())
+		{
+			continue;
+		}
+
+		const TArray<int32>* CellTriggers = Cells.Find(GetCell(Pawn->GetActorLocation()));
+
+		if (!CellTriggers)
+		{
+			continue;
+		}
+
+		const FVector PawnLocation = Pawn->GetActorLocation();
+		const float PawnRadius = FMath::Min(Pawn->GetSimpleCollisionRadius(), MaxPawnRadius);
+
+		for (int32 Handle : *CellTriggers)
+		{
+			const FProximityTrigger& Trigger = Triggers[Handle];
+
+			++NumTests;
+
+			if (Trigger.bEnabled
+				&& FVector::DistSquared(PawnLocation, Trigger.Location) <= FMath::Square(Trigger.Params.Radius + PawnRadius)
+				&& PassesFilter(Trigger, Pawn))
+			{
+				NowInside.FindOrAdd(Handle).Add(Pawn);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ProximityTriggerTests, NumTests);
+
+	// a pawn entering a trigger, remembered until the events are fired
+	struct FProximityEnter
+	{
+		int32 Handle;
+		uint32 Generation;
+		TWeakObjectPtr<APawn> Pawn;
+	};
+
+	// collect the pawns that weren't inside last frame
+	TArray<FProximityEnter> Enters;
+
+	for (const TPair<int32, TArray<APawn*, TInlineAllocator<2>>>& Pair : NowInside)
+	{
+		const FProximityTrigger& Trigger = Triggers[Pair.Key];
+
+		for (APawn* Pawn : Pair.Value)
+		{
+			if (!Trigger.PawnsInside.Contains(Pawn))
+			{
+				Enters.Add({ Pair.Key, Trigger.Generation, Pawn });
+			}
+		}
+	}
+
+	// pawns that left are forgotten
+	for (int32 Handle : OccupiedTriggers)
+	{
+		if (!NowInside.Contains(Handle))
+		{
+			Triggers[Handle].PawnsInside.Reset();
+		}
+	}
+
+	OccupiedTriggers.Reset();
+
+	for (const TPair<int32, TArray<APawn*, TInlineAllocator<2>>>& Pair : NowInside)
+	{
+		FProximityTrigger& Trigger = Triggers[Pair.Key];
+		Trigger.PawnsInside.Reset();
+		Trigger.PawnsInside.Append(Pair.Value);
+
+		OccupiedTriggers.Add(Pair.Key);
+	}
+
+	// fire the enter events last. Handlers may disable, move, unregister or register triggers
+	for (const FProximityEnter& Enter : Enters)
+	{
+		APawn* Pawn = Enter.Pawn.Get();
+
+		// a trigger registered by an earlier handler may have reused the handle of one that was removed
+		if (Pawn && Triggers.IsValidIndex(Enter.Handle) && Triggers[Enter.Handle].Generation == Enter.Generation && Triggers[Enter.Handle].bEnabled)
+		{
+			// copy the delegate, the handler may remove the trigger
+			const FProximityTriggerDelegate OnEnter = Triggers[Enter.Handle].Params.OnEnter;
+			OnEnter.ExecuteIfBound(Pawn);
+		}
+	}
+}
+
+TStatId UProximityTriggerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProximityTriggerSubsystem, STATGROUP_Tickables);
+}
+
+FIntVector UProximityTriggerSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UProximityTriggerSubsystem::AddToCells(int32 Handle)
+{
+	// the first trigger picks the cell size
+	if (CellSize <= 0.0f)
+	{
+		CellSize = FMath::Max(1.0f, CVarProximityCellSize.GetValueOnGameThread());
+	}
+
+	FProximityTrigger& Trigger = Triggers[Handle];
+
+	// bucket the trigger in every cell a pawn touching it could stand in
+	const FVector Reach(Trigger.Params.Radius + MaxPawnRadius);
+	const FIntVector MinCell = GetCell(Trigger.Location - Reach);
+	const FIntVector MaxCell = GetCell(Trigger.Location + Reach);
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				const FIntVector Cell(X, Y, Z);
+
+				Cells.FindOrAdd(Cell).Add(Handle);
+				Trigger.Cells.Add(Cell);
+			}
+		}
+	}
+}
+
+void UProximityTriggerSubsystem::RemoveFromCells(int32 Handle)
+{
+	FProximityTrigger& Trigger = Triggers[Handle];
+
+	for (const FIntVector& Cell : Trigger.Cells)
+	{
+		if (TArray<int32>* CellTriggers = Cells.Find(Cell))
+		{
+			CellTriggers->RemoveSingleSwap(Handle, EAllowShrinking::No);
+
+			if (CellTriggers->IsEmpty())
+			{
+				Cells.Remove(Cell);
+			}
+		}
+	}
+
+	Trigger.Cells.Reset();
+}
+
+void UProximityTriggerSubsystem::RebuildCells()
+{
+	Cells.Reset();
+	CellSize = FMath::Max(1.0f, CVarProximityCellSize.GetValueOnGameThread());
+
+	for (auto It = Triggers.CreateIterator(); It; ++It)
+	{
+		It->Cells.Reset();
+		AddToCells(It.GetIndex());
+	}
+}
+
+bool UProximityTriggerSubsystem::PassesFilter(const FProximityTrigger& Trigger, const APawn* Pawn)
+{
+	if (Trigger.Params.bAliveOnly)
+	{
+		const AFirstPersonCharacter* Character = Cast<AFirstPersonCharacter>(Pawn);
+
+		if (Character && Character->IsKilled())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
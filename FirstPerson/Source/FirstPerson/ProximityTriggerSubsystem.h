@@ -0,0 +1,120 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProximityTriggerSubsystem.generated.h"
+
+class APawn;
+
+DECLARE_DELEGATE_OneParam(FProximityTriggerDelegate, APawn*);
+
+/**
+ *  Parameters of a proximity trigger
+ */
+struct FProximityTriggerParams
+{
+	/** Offset of the trigger center from its owner's location */
+	FVector Offset = FVector::ZeroVector;
+
+	/** Radius of the trigger. Pawns enter once their collision radius touches it */
+	float Radius = 100.0f;
+
+	/** If true, dead characters don't set the trigger off */
+	bool bAliveOnly = true;
+
+	/** Called when a player pawn enters the trigger */
+	FProximityTriggerDelegate OnEnter;
+};
+
+/**
+ *  Pawn proximity triggers without physics overlaps
+ *  Actors register a radius instead of keeping an overlap sphere that runs through the physics pipeline whenever
+ *  anything moves. Triggers are bucketed once in a uniform spatial hash. Once per frame each registered pawn that is
+ *  player controlled looks up its own cell and tests the few triggers there, and enter events fire for pawns that
+ *  weren't inside last frame. Triggers only rehash when their owner tells the subsystem they moved.
+ */
+UCLASS()
+class FIRSTPERSON_API UProximityTriggerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** A registered trigger */
+	struct FProximityTrigger
+	{
+		FProximityTriggerParams Params;
+		TWeakObjectPtr<AActor> Owner;
+		FVector Location = FVector::ZeroVector;
+		bool bEnabled = true;
+
+		/** Tells this trigger apart from earlier ones that had the same handle */
+		uint32 Generation = 0;
+
+		/** Cells this trigger is bucketed in */
+		TArray<FIntVector, TInlineAllocator<4>> Cells;
+
+		/** Pawns inside the trigger as of the last update */
+		TArray<TWeakObjectPtr<APawn>, TInlineAllocator<2>> PawnsInside;
+	};
+
+	/** Registered triggers. Indices are the trigger handles */
+	TSparseArray<FProximityTrigger> Triggers;
+
+	/** Trigger indices bucketed by cell */
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	/** Triggers with pawns inside as of the last update */
+	TSet<int32> OccupiedTriggers;
+
+	/** Pawns that can set triggers off while player controlled */
+	TArray<TWeakObjectPtr<APawn>> Pawns;
+
+	/** Generation given to the next registered trigger */
+	uint32 NextGeneration = 0;
+
+	/** Cell size the triggers are currently bucketed with. Picked when the first trigger registers */
+	float CellSize = 0.0f;
+
+public:
+
+	/** Registers a trigger on an actor. Returns its handle */
+	int32 RegisterTrigger(AActor* Owner, const FProximityTriggerParams& Params);
+
+	/** Removes a trigger */
+	void UnregisterTrigger(int32 Handle);
+
+	/** Turns a trigger on or off. Pawns standing in a trigger enter it again when it's turned back on */
+	void SetTriggerEnabled(int32 Handle, bool bEnabled);
+
+	/** Moves a trigger to its owner's current location */
+	void UpdateTriggerLocation(int32 Handle);
+
+	/** Lets a pawn set triggers off while it's player controlled */
+	void RegisterPawn(APawn* Pawn);
+
+	/** Stops a pawn from setting triggers off */
+	void UnregisterPawn(APawn* Pawn);
+
+	//~Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End FTickableGameObject interface
+
+protected:
+
+	/** Returns the cell a location falls in */
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** Buckets a trigger in every cell it reaches */
+	void AddToCells(int32 Handle);
+
+	/** Removes a trigger from its cells */
+	void RemoveFromCells(int32 Handle);
+
+	/** Rebuckets every trigger after a cell size change */
+	void RebuildCells();
+
+	/** Returns true if a pawn passes a trigger's filter */
+	static bool PassesFilter(const FProximityTrigger& Trigger, const APawn* Pawn);
+};
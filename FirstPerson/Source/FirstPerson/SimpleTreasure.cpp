@@ -7,6 +7,8 @@
 #include "DrawDebugHelpers.h"
 #include "TeamGameState.h"
 #include "GameFramework/PlayerState.h"  // 
+#include "ProximityTriggerSubsystem.h"
+#include "NetUpdateRateSubsystem.h"
 ASimpleTreasure::ASimpleTreasure()
 {
     PrimaryActorTick.bCanEverTick = true;
@@ -15,11 +17,16 @@ ASimpleTreasure::ASimpleTreasure()
     // λø
     SetReplicateMovement(true);
 
+    // the location only changes on a teleport, which flushes dormancy. Otherwise connections skip the treasure entirely.
+    // treasures are placed in the level, so clients already have their initial state
+    NetDormancy = DORM_Initial;
+
     // ײ
     CollisionSphere = CreateDefaultSubobject<USphereComponent>(TEXT("CollisionSphere"));
     CollisionSphere->InitSphereRadius(60.0f);
-    CollisionSphere->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
-    CollisionSphere->SetGenerateOverlapEvents(true);
+    // players are detected by the proximity trigger subsystem instead of physics overlaps
+    CollisionSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    CollisionSphere->SetGenerateOverlapEvents(false);
     RootComponent = CollisionSphere;
 
     // Ӿ
@@ -27,9 +34,6 @@ ASimpleTreasure::ASimpleTreasure()
     TreasureMesh->SetupAttachment(RootComponent);
     TreasureMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
     TreasureMesh->SetRelativeScale3D(FVector(0.5f)); // ʵ
-
-    // лص¼
-    CollisionSphere->OnComponentBeginOverlap.AddDynamic(this, &ASimpleTreasure::OnOverlapBegin);
 }
 
 void ASimpleTreasure::BeginPlay()
@@ -39,6 +43,25 @@ void ASimpleTreasure::BeginPlay()
     // ԭʼλ
     OriginalLocation = GetActorLocation();
 
+    // only the server collects treasure
+    UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>();
+
+    if (HasAuthority() && ProximityTriggers)
+    {
+        FProximityTriggerParams TriggerParams;
+        TriggerParams.Radius = CollisionSphere->GetScaledSphereRadius();
+        TriggerParams.bAliveOnly = true;
+        TriggerParams.OnEnter.BindUObject(this, &ASimpleTreasure::OnPawnEntered);
+
+        ProximityTrigger = ProximityTriggers->RegisterTrigger(this, TriggerParams);
+    }
+
+    // the update flushed by a teleport goes out at the full rate and priority
+    if (UNetUpdateRateSubsystem* NetUpdateRate = HasAuthority() ? GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>() : nullptr)
+    {
+        NetUpdateRate->RegisterActor(this);
+    }
+
     // ߽
     float HalfRadius = TeleportRadius * 0.5f;
     BoundaryBox = FBox(
@@ -60,6 +83,28 @@ void ASimpleTreasure::BeginPlay()
 #endif
 }
 
+void ASimpleTreasure::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    Super::EndPlay(EndPlayReason);
+
+    if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+    {
+        ProximityTriggers->UnregisterTrigger(ProximityTrigger);
+    }
+
+    ProximityTrigger = INDEX_NONE;
+
+    if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+    {
+        NetUpdateRate->UnregisterActor(this);
+    }
+}
+
+float ASimpleTreasure::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+    return UNetUpdateRateSubsystem::ScaleNetPriority(this, ViewPos, Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth));
+}
+
 void ASimpleTreasure::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
@@ -83,8 +128,7 @@ void ASimpleTreasure::Tick(float DeltaTime)
     }
 }
 
-void ASimpleTreasure::OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-    UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void ASimpleTreasure::OnPawnEntered(APawn* Pawn)
 {
     // ȫ
     if (bIsOnCooldown) return;
@@ -93,7 +137,7 @@ void ASimpleTreasure::OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor
     if (GetLocalRole() != ROLE_Authority) return;
 
     // ǷΪҽɫ
-    AFirstPersonCharacter* PlayerCharacter = Cast<AFirstPersonCharacter>(OtherActor);
+    AFirstPersonCharacter* PlayerCharacter = Cast<AFirstPersonCharacter>(Pawn);
     if (!PlayerCharacter) return;
     // Ƿ
     if (PlayerCharacter->IsKilled()) return;
@@ -132,11 +176,36 @@ void ASimpleTreasure::OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor
     {
         ShowPickupEffect(GetActorLocation());
     }
+
+    Teleport();
+}
+
+void ASimpleTreasure::Teleport()
+{
     // λ
     FVector NewLocation = GenerateRandomLocation();
+    // wake the treasure for one update so clients receive the new location
+    FlushNetDormancy();
+
+#if WITH_DEV_AUTOMATION_TESTS
+    ++NumDormancyFlushes;
+#endif
+
     // λãԶƵпͻˣ
     SetActorLocation(NewLocation);
 
+    // move the trigger along
+    if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+    {
+        ProximityTriggers->UpdateTriggerLocation(ProximityTrigger);
+    }
+
+    // send the new location out at the full rate
+    if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+    {
+        NetUpdateRate->NotifyActivity(this);
+    }
+
     // ־
     //UE_LOG(LogTemp, Log, TEXT("SimpleTreasure moved to new location: %s"), *NewLocation.ToString());
 }
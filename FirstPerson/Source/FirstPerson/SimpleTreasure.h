@@ -15,16 +15,20 @@ class FIRSTPERSON_API ASimpleTreasure : public AActor
 public:
     ASimpleTreasure();
 
+    /** Scales the net priority by activity and distance from the viewer */
+    virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
 protected:
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     virtual void Tick(float DeltaTime) override;
 
 private:
     /** ص¼ - ֻڷִ */
-    UFUNCTION()
-    void OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-        UPrimitiveComponent* OtherComp, int32 OtherBodyIndex,
-        bool bFromSweep, const FHitResult& SweepResult);
+    void OnPawnEntered(APawn* Pawn);
+
+    /** Moves the treasure to a new random location and wakes it for the one update that sends it */
+    void Teleport();
 
     /** λ */
     FVector GenerateRandomLocation() const;
@@ -76,10 +80,20 @@ private:
     /** ȴʱ */
     float CooldownTimer = 0.0f;
 
+    /** Handle of the proximity trigger that collects this treasure */
+    int32 ProximityTrigger = INDEX_NONE;
+
     /** ԭʼλãڱ߽飩 */
-    FVector OriginalLocation;
+    FVector OriginalLocation = FVector::ZeroVector;
 
     /** ߽УƶΧ */
     FBox BoundaryBox;
     FBox VisBox;
+
+#if WITH_DEV_AUTOMATION_TESTS
+    /** Number of dormancy flushes so far, checked by the automation tests */
+    int32 NumDormancyFlushes = 0;
+
+    friend class FSimpleTreasureDormancyTest;
+#endif
 };
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "TeamGameState.h"
 #include <Net/UnrealNetwork.h>
+#include "Net/Core/PushModel/PushModel.h"
+#include "ShooterPickupRegistry.h"
+#include "FirstPerson.h"
+
+/** Push model properties registered in GetLifetimeReplicatedProps */
+static constexpr int32 NumPushProperties = 4;
 
 ATeamGameState::ATeamGameState()
 {
@@ -9,9 +15,28 @@ ATeamGameState::ATeamGameState()
 void ATeamGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
     Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-    DOREPLIFETIME(ATeamGameState, TeamScores);
-    DOREPLIFETIME(ATeamGameState, RemainingTime); // 
-    DOREPLIFETIME(ATeamGameState, bGameEnded);    // 
+
+    // everything here changes a few times per match, so it's only compared after being marked dirty
+    FDoRepLifetimeParams Params;
+    Params.bIsPushBased = true;
+
+    DOREPLIFETIME_WITH_PARAMS_FAST(ATeamGameState, TeamScores, Params);
+    DOREPLIFETIME_WITH_PARAMS_FAST(ATeamGameState, RemainingTime, Params); // 
+    DOREPLIFETIME_WITH_PARAMS_FAST(ATeamGameState, bGameEnded, Params);    // 
+    DOREPLIFETIME_WITH_PARAMS_FAST(ATeamGameState, ConsumedPickups, Params);
+}
+
+void ATeamGameState::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+    Super::PreReplication(ChangedPropertyTracker);
+
+    // the net driver is about to consider the game state. If nothing was marked dirty, none of the properties are compared
+    if (!bPushPropertiesDirty)
+    {
+        INC_DWORD_STAT_BY(STAT_PushModelComparisonsSkipped, NumPushProperties);
+    }
+
+    bPushPropertiesDirty = false;
 }
 
 void ATeamGameState::OnRep_TeamScores()
@@ -23,5 +48,99 @@ void ATeamGameState::AddScore(int32 TeamIndex, int32 Score)
     if (GetLocalRole() == ROLE_Authority && TeamIndex >= 0 && TeamIndex < TeamScores.Num())
     {
         TeamScores[TeamIndex] += Score;
+
+        MARK_PROPERTY_DIRTY_FROM_NAME(ATeamGameState, TeamScores, this);
+        bPushPropertiesDirty = true;
+    }
+}
+
+void ATeamGameState::SetRemainingTime(float NewRemainingTime)
+{
+    if (!HasAuthority())
+    {
+        return;
+    }
+
+    // the HUD shows whole seconds, so only send the time when that changes
+    const bool bSecondChanged = FMath::CeilToInt(NewRemainingTime) != FMath::CeilToInt(RemainingTime);
+
+    RemainingTime = NewRemainingTime;
+
+    if (bSecondChanged)
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(ATeamGameState, RemainingTime, this);
+        bPushPropertiesDirty = true;
+    }
+}
+
+void ATeamGameState::SetGameEnded(bool bNewGameEnded)
+{
+    if (!HasAuthority() || bGameEnded == bNewGameEnded)
+    {
+        return;
+    }
+
+    bGameEnded = bNewGameEnded;
+
+    MARK_PROPERTY_DIRTY_FROM_NAME(ATeamGameState, bGameEnded, this);
+    bPushPropertiesDirty = true;
+}
+
+void ATeamGameState::OnRep_ConsumedPickups(const TArray<uint32>& OldConsumedPickups)
+{
+    UShooterPickupRegistry* PickupRegistry = GetWorld()->GetSubsystem<UShooterPickupRegistry>();
+    if (!PickupRegistry)
+    {
+        return;
+    }
+
+    // only the words that changed carry news
+    const int32 NumWords = FMath::Max(ConsumedPickups.Num(), OldConsumedPickups.Num());
+
+    for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex)
+    {
+        const uint32 NewWord = ConsumedPickups.IsValidIndex(WordIndex) ? ConsumedPickups[WordIndex] : 0;
+        const uint32 OldWord = OldConsumedPickups.IsValidIndex(WordIndex) ? OldConsumedPickups[WordIndex] : 0;
+
+        for (uint32 Changed = NewWord ^ OldWord; Changed != 0; Changed &= Changed - 1)
+        {
+            const int32 Bit = FMath::CountTrailingZeros(Changed);
+            PickupRegistry->NotifyPickupAvailabilityChanged(WordIndex * 32 + Bit, (NewWord & (1u << Bit)) == 0);
+        }
+    }
+}
+
+void ATeamGameState::SetPickupConsumed(int32 PickupIndex, bool bConsumed)
+{
+    if (!HasAuthority() || PickupIndex < 0)
+    {
+        return;
+    }
+
+    const int32 WordIndex = PickupIndex / 32;
+    const uint32 Mask = 1u << (PickupIndex % 32);
+
+    // grow the bitfield only as far as the highest pickup that was ever consumed
+    if (ConsumedPickups.Num() <= WordIndex)
+    {
+        ConsumedPickups.SetNumZeroed(WordIndex + 1);
+    }
+
+    if (bConsumed)
+    {
+        ConsumedPickups[WordIndex] |= Mask;
+    }
+    else
+    {
+        ConsumedPickups[WordIndex] &= ~Mask;
     }
+
+    MARK_PROPERTY_DIRTY_FROM_NAME(ATeamGameState, ConsumedPickups, this);
+    bPushPropertiesDirty = true;
+}
+
+bool ATeamGameState::IsPickupConsumed(int32 PickupIndex) const
+{
+    const int32 WordIndex = PickupIndex / 32;
+    return PickupIndex >= 0 && ConsumedPickups.IsValidIndex(WordIndex) && (ConsumedPickups[WordIndex] & (1u << (PickupIndex % 32))) != 0;
 }
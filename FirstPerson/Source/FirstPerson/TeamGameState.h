@@ -35,4 +35,33 @@ public:
 
     UPROPERTY(Replicated)
     bool bGameEnded = false;
+
+    /** Sets the remaining match time. Clients only hear about it when the whole second changes. Server only */
+    void SetRemainingTime(float NewRemainingTime);
+
+    /** Ends or restarts the match. Server only */
+    void SetGameEnded(bool bNewGameEnded);
+
+    // ===== Pickup availability =====
+
+    /** One bit per level pickup, set while the pickup is consumed. Indexed by UShooterPickupRegistry */
+    UPROPERTY(ReplicatedUsing = OnRep_ConsumedPickups)
+    TArray<uint32> ConsumedPickups;
+
+    UFUNCTION()
+    void OnRep_ConsumedPickups(const TArray<uint32>& OldConsumedPickups);
+
+    /** Marks a pickup as consumed, or available again. Server only */
+    void SetPickupConsumed(int32 PickupIndex, bool bConsumed);
+
+    /** Returns true if a pickup is currently consumed */
+    bool IsPickupConsumed(int32 PickupIndex) const;
+
+    /** Counts the push model properties skipped when the net driver finds nothing marked dirty */
+    virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+protected:
+
+    /** If true, a push model property was marked dirty since the net driver last considered the game state. Server only */
+    bool bPushPropertiesDirty = false;
 };
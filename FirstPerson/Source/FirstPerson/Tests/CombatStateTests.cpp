@@ -0,0 +1,102 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatStateComponent.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/BitReader.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CombatStateTests
+{
+	/** Payload bits of the state this struct replaced: a float health and a bool death flag, replicated separately */
+	constexpr int64 PreviousStateBits = 32 + 1;
+
+	/** Serializes a state and reads it back. Returns the number of bits it took */
+	int64 RoundTrip(const FCombatState& State, FCombatState& OutState)
+	{
+		FBitWriter Writer(256, true);
+		bool bSuccess = false;
+
+		FCombatState WriteState = State;
+		WriteState.NetSerialize(Writer, nullptr, bSuccess);
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		OutState.NetSerialize(Reader, nullptr, bSuccess);
+
+		return Writer.GetNumBits();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCombatStateRoundTripTest, "FirstPerson.Combat.CombatState.RoundTrip",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCombatStateRoundTripTest::RunTest(const FString& Parameters)
+{
+	FCombatState Damaged;
+	Damaged.SetHealthFraction(0.37f);
+	Damaged.LastInstigatorId = 5;
+
+	FCombatState Dead;
+	Dead.SetHealthFraction(0.0f);
+	Dead.bDead = true;
+	Dead.SetRespawnTime(1234.5);
+	Dead.LastInstigatorId = 300;
+
+	for (const FCombatState& State : { FCombatState(), Damaged, Dead })
+	{
+		FCombatState ReadState;
+		ReadState.LastInstigatorId = 99;
+
+		CombatStateTests::RoundTrip(State, ReadState);
+
+		TestTrue(TEXT("State survives the round trip"), ReadState == State);
+	}
+
+	// any health left stays above zero once quantized
+	FCombatState Scratched;
+	Scratched.SetHealthFraction(0.0001f);
+	TestTrue(TEXT("A sliver of health is still alive"), Scratched.Health > 0);
+	TestEqual(TEXT("Respawn time keeps a tenth of a second"), Dead.GetRespawnTime(), 1234.5);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCombatStateBitsTest, "FirstPerson.Combat.CombatState.Bits",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCombatStateBitsTest::RunTest(const FString& Parameters)
+{
+	FCombatState ReadState;
+
+	// alive and untouched: 12 bits of health and the two flags
+	const int64 AliveBits = CombatStateTests::RoundTrip(FCombatState(), ReadState);
+	TestEqual(TEXT("Alive state bits"), AliveBits, static_cast<int64>(14));
+
+	// damaged by a player, as sent for every hit
+	FCombatState Damaged;
+	Damaged.SetHealthFraction(0.5f);
+	Damaged.LastInstigatorId = 12;
+
+	const int64 DamagedBits = CombatStateTests::RoundTrip(Damaged, ReadState);
+
+	// dead, with a respawn time ten minutes into the match
+	FCombatState Dead;
+	Dead.SetHealthFraction(0.0f);
+	Dead.bDead = true;
+	Dead.SetRespawnTime(600.0);
+
+	const int64 DeadBits = CombatStateTests::RoundTrip(Dead, ReadState);
+
+	AddInfo(FString::Printf(TEXT("Combat state bits: alive %lld, damaged %lld, dead %lld. Previous float and bool: %lld"), AliveBits, DamagedBits, DeadBits, CombatStateTests::PreviousStateBits));
+
+	// the previous state also spent a property header on each of its two properties, so this is the conservative comparison
+	TestTrue(TEXT("Alive state is smaller than the previous state"), AliveBits < CombatStateTests::PreviousStateBits);
+	TestTrue(TEXT("Damaged state, instigator included, is smaller than the previous state"), DamagedBits < CombatStateTests::PreviousStateBits);
+	TestTrue(TEXT("Dead state, respawn time included, is smaller than the previous state"), DeadBits < CombatStateTests::PreviousStateBits);
+
+	return true;
+}
+
+#endif
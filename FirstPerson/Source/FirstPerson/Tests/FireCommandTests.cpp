@@ -0,0 +1,149 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "FireCommandComponent.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FireCommandTests
+{
+	constexpr float MinInterval = 0.1f;
+	constexpr float Tolerance = 0.05f;
+	constexpr float MaxAge = 1.0f;
+	constexpr int32 MaxBurst = 2;
+
+	/** Validates a command with the test settings */
+	bool Validate(double CommandTime, double Now, FFireCommandBudget& Budget)
+	{
+		return UFireCommandComponent::ValidateCommandTime(CommandTime, Now, Budget, MinInterval, Tolerance, MaxAge, MaxBurst);
+	}
+
+	/** Feeds commands stamped at the given client times, all received at server time Now. Returns the number accepted */
+	int32 CountAcceptedTogether(TConstArrayView<double> CommandTimes, double Now)
+	{
+		FFireCommandBudget Budget;
+		int32 NumAccepted = 0;
+
+		for (const double CommandTime : CommandTimes)
+		{
+			NumAccepted += Validate(CommandTime, Now, Budget) ? 1 : 0;
+		}
+
+		return NumAccepted;
+	}
+
+	/** Feeds commands stamped at the given client times, each received at its own time plus Latency. Returns the number accepted */
+	int32 CountAccepted(TConstArrayView<double> CommandTimes, double Latency = 0.05)
+	{
+		FFireCommandBudget Budget;
+		int32 NumAccepted = 0;
+
+		for (const double CommandTime : CommandTimes)
+		{
+			if (Validate(CommandTime, CommandTime + Latency, Budget))
+			{
+				++NumAccepted;
+			}
+		}
+
+		return NumAccepted;
+	}
+
+	/** Returns NumShots client times spaced Spacing apart */
+	TArray<double> MakeShots(int32 NumShots, double Spacing, double StartTime = 10.0)
+	{
+		TArray<double> Times;
+		for (int32 Shot = 0; Shot < NumShots; ++Shot)
+		{
+			Times.Add(StartTime + Shot * Spacing);
+		}
+
+		return Times;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireCommandTimestampsTest, "FirstPerson.Weapons.FireCommands.Timestamps",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFireCommandTimestampsTest::RunTest(const FString& Parameters)
+{
+	using namespace FireCommandTests;
+
+	FFireCommandBudget Budget;
+
+	// stamped in the future, past the tolerance
+	TestFalse(TEXT("Future timestamp is rejected"), Validate(10.2, 10.0, Budget));
+
+	// stamped too long ago
+	TestFalse(TEXT("Stale timestamp is rejected"), Validate(8.5, 10.0, Budget));
+	TestEqual(TEXT("Rejected commands don't spend the budget"), Budget.LastAcceptedTime, -1.0);
+	TestEqual(TEXT("Rejected commands don't spend the receive budget"), Budget.ReceiveBudgetTime, -1.0);
+
+	// a slightly early clock is within the tolerance
+	TestTrue(TEXT("Timestamp within the tolerance is accepted"), Validate(10.04, 10.0, Budget));
+	TestEqual(TEXT("First command is charged at its own time"), Budget.LastAcceptedTime, 10.04);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireCommandFireRateTest, "FirstPerson.Weapons.FireCommands.FireRate",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFireCommandFireRateTest::RunTest(const FString& Parameters)
+{
+	using namespace FireCommandTests;
+
+	// an honest client at the fire rate, with some jitter, loses nothing
+	TArray<double> Honest = MakeShots(20, MinInterval);
+	for (int32 Shot = 1; Shot < Honest.Num(); Shot += 2)
+	{
+		Honest[Shot] -= Tolerance * 0.8;
+	}
+
+	TestEqual(TEXT("Jittered shots at the fire rate are all accepted"), CountAccepted(Honest), Honest.Num());
+
+	// commands resent together after a loss arrive at once, and are accepted up to the burst
+	TestEqual(TEXT("Resent commands are accepted up to the burst"), CountAcceptedTogether(MakeShots(4, MinInterval), 10.5), MaxBurst);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireCommandSpoofedTimestampsTest, "FirstPerson.Weapons.FireCommands.SpoofedTimestamps",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFireCommandSpoofedTimestampsTest::RunTest(const FString& Parameters)
+{
+	using namespace FireCommandTests;
+
+	// a client claiming the tolerance on every shot fires at most one extra shot, not 1 / (1 - Tolerance / MinInterval) times faster
+	constexpr int32 NumShots = 100;
+	const TArray<double> Spoofed = MakeShots(NumShots, MinInterval - Tolerance * 0.99);
+
+	const double Elapsed = Spoofed.Last() - Spoofed[0];
+	const int32 MaxHonest = FMath::FloorToInt32(Elapsed / MinInterval) + 1;
+
+	const int32 NumAccepted = CountAccepted(Spoofed);
+	TestTrue(FString::Printf(TEXT("Spoofed shots accepted %d, fire rate allows %d"), NumAccepted, MaxHonest), NumAccepted <= MaxHonest + 1);
+
+	// a client stamping its shots apart while sending them in a burst is held to the server clock
+	TestEqual(TEXT("Burst stamped into the future is cut off at the tolerance"), CountAcceptedTogether(MakeShots(10, MinInterval), 10.0), 1);
+
+	// after idling, a burst backdated across the whole max age is held to the receive budget
+	const TArray<double> Backdated = MakeShots(FMath::FloorToInt32(MaxAge / MinInterval) + 1, MinInterval, 20.0 - MaxAge);
+	TestEqual(TEXT("Backdated burst is cut off at the burst size"), CountAcceptedTogether(Backdated, 20.0), MaxBurst);
+
+	// once the burst is spent, the receive budget only refills at the fire rate
+	FFireCommandBudget Budget;
+	for (const double CommandTime : Backdated)
+	{
+		Validate(CommandTime, 20.0, Budget);
+	}
+
+	TestFalse(TEXT("No shot before the budget refills"), Validate(20.02, 20.02, Budget));
+	TestTrue(TEXT("Shot once the budget refills"), Validate(20.15, 20.15, Budget));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "NetUpdateRateSubsystem.h"
+#include "ScopedTestGameWorld.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace NetUpdateRateTests
+{
+	/** Returns the value of a net rate cvar */
+	float GetCVarFloat(const TCHAR* Name)
+	{
+		const IConsoleVariable* CVar = IConsoleManager::Get().FindConsoleVariable(Name);
+		return CVar ? CVar->GetFloat() : 0.0f;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNetUpdateRatePriorityTest, "FirstPerson.Net.UpdateRate.Priority",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FNetUpdateRatePriorityTest::RunTest(const FString& Parameters)
+{
+	FScopedTestGameWorld World;
+
+	UNetUpdateRateSubsystem* Subsystem = World->GetSubsystem<UNetUpdateRateSubsystem>();
+	AActor* Actor = World->SpawnActor<AActor>();
+
+	if (TestNotNull(TEXT("Subsystem"), Subsystem) && TestNotNull(TEXT("Actor"), Actor))
+	{
+		const FVector NearView(100.0, 0.0, 0.0);
+		const FVector FarView(NetUpdateRateTests::GetCVarFloat(TEXT("FirstPerson.NetRate.FarDistance")) * 2.0f, 0.0, 0.0);
+
+		TestEqual(TEXT("Unregistered actors keep their priority"), UNetUpdateRateSubsystem::ScaleNetPriority(Actor, FarView, 3.0f), 3.0f);
+
+		Subsystem->RegisterActor(Actor);
+
+		// idle actors keep their priority up close and halve it far away
+		TestEqual(TEXT("Idle actor near the view"), UNetUpdateRateSubsystem::ScaleNetPriority(Actor, NearView, 3.0f), 3.0f, 1.e-4f);
+		TestEqual(TEXT("Idle actor far from the view"), UNetUpdateRateSubsystem::ScaleNetPriority(Actor, FarView, 3.0f), 1.5f, 1.e-4f);
+
+		// active actors double it
+		Subsystem->NotifyActivity(Actor);
+
+		TestEqual(TEXT("Active actor near the view"), UNetUpdateRateSubsystem::ScaleNetPriority(Actor, NearView, 3.0f), 6.0f, 1.e-4f);
+		TestEqual(TEXT("Active actor far from the view"), UNetUpdateRateSubsystem::ScaleNetPriority(Actor, FarView, 3.0f), 3.0f, 1.e-4f);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNetUpdateRateEvaluationTest, "FirstPerson.Net.UpdateRate.Evaluation",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FNetUpdateRateEvaluationTest::RunTest(const FString& Parameters)
+{
+	FScopedTestGameWorld World;
+
+	UNetUpdateRateSubsystem* Subsystem = World->GetSubsystem<UNetUpdateRateSubsystem>();
+	AActor* Actor = World->SpawnActor<AActor>();
+
+	if (TestNotNull(TEXT("Subsystem"), Subsystem) && TestNotNull(TEXT("Actor"), Actor))
+	{
+		const float MaxRate = AActor::StaticClass()->GetDefaultObject<AActor>()->GetNetUpdateFrequency();
+		const float MinRate = FMath::Min(NetUpdateRateTests::GetCVarFloat(TEXT("FirstPerson.NetRate.MinRate")), MaxRate);
+		const float Interval = NetUpdateRateTests::GetCVarFloat(TEXT("FirstPerson.NetRate.Interval"));
+
+		Subsystem->RegisterActor(Actor);
+
+		// with no player looking, the evaluation drops the actor to the minimum rate
+		Subsystem->Tick(Interval + 0.01f);
+		TestEqual(TEXT("Unwatched actor runs at the minimum rate"), Actor->GetNetUpdateFrequency(), MinRate, 0.5f);
+
+		// activity brings it back to full rate right away
+		Subsystem->NotifyActivity(Actor);
+		TestEqual(TEXT("Active actor runs at its class rate"), Actor->GetNetUpdateFrequency(), MaxRate);
+
+		// dormant actors are left alone
+		Actor->SetNetDormancy(DORM_DormantAll);
+		Subsystem->Tick(Interval + 0.01f);
+		TestEqual(TEXT("Dormant actor keeps its rate"), Actor->GetNetUpdateFrequency(), MaxRate);
+
+		// unregistering restores the class rate
+		Actor->SetNetDormancy(DORM_Awake);
+		Subsystem->Tick(Interval + 0.01f);
+		Subsystem->UnregisterActor(Actor);
+		TestEqual(TEXT("Unregistered actor is back to its class rate"), Actor->GetNetUpdateFrequency(), MaxRate);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,183 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ProjectileBallistics.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ProjectileBallisticsTests
+{
+	/** Steps a single projectile the straightforward way, as the reference the vectorized kernel has to match */
+	void ReferenceStep(FVector& Position, FVector& Velocity, double GravityZ, double Drag)
+	{
+		const double Speed = Velocity.Size();
+		const FVector Acceleration = FVector(0.0, 0.0, GravityZ) - Velocity * (Drag * Speed);
+
+		Velocity += Acceleration * FProjectileBallistics::FixedStep;
+		Position += Velocity * FProjectileBallistics::FixedStep;
+	}
+
+	/** Steps a single projectile through the kernel */
+	void KernelSteps(FVector& Position, FVector& Velocity, float GravityZ, float Drag, int32 NumSteps)
+	{
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			FProjectileBallistics::Step(MakeArrayView(&Position, 1), MakeArrayView(&Velocity, 1), MakeArrayView(&GravityZ, 1), MakeArrayView(&Drag, 1));
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsStraightLineTest, "FirstPerson.Projectiles.Ballistics.StraightLine",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsStraightLineTest::RunTest(const FString& Parameters)
+{
+	// without gravity or drag, a projectile moves at its launch velocity
+	FVector Position(100.0, -50.0, 20.0);
+	FVector Velocity(3000.0, 0.0, 0.0);
+
+	ProjectileBallisticsTests::KernelSteps(Position, Velocity, 0.0f, 0.0f, 120);
+
+	TestEqual(TEXT("Velocity is unchanged"), Velocity, FVector(3000.0, 0.0, 0.0));
+	TestEqual(TEXT("Position after 120 steps"), Position, FVector(100.0 + 3000.0 * 120 * FProjectileBallistics::FixedStep, -50.0, 20.0), 1.e-6f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsGravityTest, "FirstPerson.Projectiles.Ballistics.Gravity",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsGravityTest::RunTest(const FString& Parameters)
+{
+	// semi-implicit Euler under constant gravity has a closed form:
+	// v(n) = v0 + n * g * dt
+	// x(n) = x0 + n * dt * v0 + g * dt^2 * n * (n + 1) / 2
+	constexpr int32 NumSteps = 120;
+	constexpr float GravityZ = -980.0f;
+	constexpr double Dt = FProjectileBallistics::FixedStep;
+
+	const FVector StartVelocity(1000.0, 0.0, 500.0);
+
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity = StartVelocity;
+
+	ProjectileBallisticsTests::KernelSteps(Position, Velocity, GravityZ, 0.0f, NumSteps);
+
+	const FVector ExpectedVelocity = StartVelocity + FVector(0.0, 0.0, NumSteps * GravityZ * Dt);
+	const FVector ExpectedPosition = StartVelocity * (NumSteps * Dt) + FVector(0.0, 0.0, GravityZ * Dt * Dt * NumSteps * (NumSteps + 1) * 0.5);
+
+	TestEqual(TEXT("Velocity after 120 steps"), Velocity, ExpectedVelocity, 1.e-6f);
+	TestEqual(TEXT("Position after 120 steps"), Position, ExpectedPosition, 1.e-6f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsDragTest, "FirstPerson.Projectiles.Ballistics.Drag",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsDragTest::RunTest(const FString& Parameters)
+{
+	constexpr float GravityZ = -980.0f;
+	constexpr float Drag = 0.0002f;
+
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity(5000.0, 1000.0, 2000.0);
+
+	FVector ReferencePosition = Position;
+	FVector ReferenceVelocity = Velocity;
+
+	// two seconds of flight, checked against the scalar reference every step
+	for (int32 Step = 0; Step < 240; ++Step)
+	{
+		const double PreviousSpeed = Velocity.Size2D();
+
+		ProjectileBallisticsTests::KernelSteps(Position, Velocity, GravityZ, Drag, 1);
+		ProjectileBallisticsTests::ReferenceStep(ReferencePosition, ReferenceVelocity, GravityZ, Drag);
+
+		if (!TestTrue(TEXT("Drag slows the horizontal velocity"), Velocity.Size2D() < PreviousSpeed))
+		{
+			break;
+		}
+	}
+
+	TestEqual(TEXT("Velocity matches the reference"), Velocity, ReferenceVelocity, 1.e-6f);
+	TestEqual(TEXT("Position matches the reference"), Position, ReferencePosition, 1.e-6f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsBatchTest, "FirstPerson.Projectiles.Ballistics.Batch",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsBatchTest::RunTest(const FString& Parameters)
+{
+	// projectiles stepped together land on exactly the same positions as projectiles stepped alone
+	TArray<FVector> Positions = { FVector(0.0, 0.0, 100.0), FVector(50.0, 20.0, 0.0), FVector(-300.0, 0.0, 900.0) };
+	TArray<FVector> Velocities = { FVector(3000.0, 0.0, 0.0), FVector(1000.0, 1000.0, 1500.0), FVector(0.0, -2500.0, 300.0) };
+	const TArray<float> GravityZs = { 0.0f, -980.0f, -490.0f };
+	const TArray<float> Drags = { 0.0f, 0.0001f, 0.0005f };
+
+	TArray<FVector> SinglePositions = Positions;
+	TArray<FVector> SingleVelocities = Velocities;
+
+	for (int32 Step = 0; Step < 120; ++Step)
+	{
+		FProjectileBallistics::Step(Positions, Velocities, GravityZs, Drags);
+	}
+
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		ProjectileBallisticsTests::KernelSteps(SinglePositions[Index], SingleVelocities[Index], GravityZs[Index], Drags[Index], 120);
+
+		TestTrue(FString::Printf(TEXT("Projectile %d position is identical"), Index), Positions[Index] == SinglePositions[Index]);
+		TestTrue(FString::Printf(TEXT("Projectile %d velocity is identical"), Index), Velocities[Index] == SingleVelocities[Index]);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsConsumeStepsTest, "FirstPerson.Projectiles.Ballistics.ConsumeSteps",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsConsumeStepsTest::RunTest(const FString& Parameters)
+{
+	// a second of frames runs a second of steps, whatever the frame rate
+	for (const float FrameRate : { 30.0f, 60.0f, 144.0f })
+	{
+		float Accumulator = 0.0f;
+		int32 TotalSteps = 0;
+
+		for (int32 Frame = 0; Frame < FMath::RoundToInt32(FrameRate); ++Frame)
+		{
+			TotalSteps += FProjectileBallistics::ConsumeSteps(Accumulator, 1.0f / FrameRate);
+		}
+
+		TestTrue(FString::Printf(TEXT("%.0f fps runs 119 to 120 steps per second, ran %d"), FrameRate, TotalSteps), TotalSteps >= 119 && TotalSteps <= 120);
+	}
+
+	// a hitch runs at most the step cap and drops the rest
+	float Accumulator = 0.0f;
+	TestEqual(TEXT("Hitch is capped"), FProjectileBallistics::ConsumeSteps(Accumulator, 0.5f), FProjectileBallistics::MaxStepsPerFrame);
+	TestTrue(TEXT("Hitch leftover is dropped"), Accumulator <= FProjectileBallistics::FixedStep);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileBallisticsBounceTest, "FirstPerson.Projectiles.Ballistics.Bounce",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileBallisticsBounceTest::RunTest(const FString& Parameters)
+{
+	const FVector Velocity(100.0, 0.0, -100.0);
+	const FVector Floor(0.0, 0.0, 1.0);
+
+	// the normal part flips and keeps the restitution, the tangent part loses the friction
+	TestEqual(TEXT("Bounce off the floor"), FProjectileBallistics::Bounce(Velocity, Floor, 0.5f, 0.2f), FVector(80.0, 0.0, 50.0), 1.e-4f);
+	TestEqual(TEXT("Perfectly elastic bounce"), FProjectileBallistics::Bounce(Velocity, Floor, 1.0f, 0.0f), FVector(100.0, 0.0, 100.0), 1.e-4f);
+	TestEqual(TEXT("Dead stop"), FProjectileBallistics::Bounce(Velocity, Floor, 0.0f, 1.0f), FVector::ZeroVector, 1.e-4f);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "TeamGameState.h"
+#include "CombatStateComponent.h"
+#include "ScopedTestGameWorld.h"
+#include "Net/UnrealNetwork.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace PushModelTests
+{
+	/** Checks that every replicated property a class declares itself is push based */
+	void TestPushBased(FAutomationTestBase& Test, UClass* Class)
+	{
+		// rep indices point into the class reps
+		Class->SetUpRuntimeReplicationData();
+
+		TArray<FLifetimeProperty> LifetimeProps;
+		Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProps);
+
+		int32 NumOwnProperties = 0;
+
+		for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+		{
+			if (!Class->ClassReps.IsValidIndex(LifetimeProp.RepIndex))
+			{
+				continue;
+			}
+
+			const FProperty* Property = Class->ClassReps[LifetimeProp.RepIndex].Property;
+
+			if (Property->GetOwnerClass() == Class)
+			{
+				++NumOwnProperties;
+				Test.TestTrue(FString::Printf(TEXT("%s::%s is push based"), *Class->GetName(), *Property->GetName()), LifetimeProp.bIsPushBased);
+			}
+		}
+
+		Test.TestTrue(FString::Printf(TEXT("%s replicates its own properties"), *Class->GetName()), NumOwnProperties > 0);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPushModelPropertiesTest, "FirstPerson.Net.PushModel.Properties",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPushModelPropertiesTest::RunTest(const FString& Parameters)
+{
+	// these properties change a few times per match, and are only compared once their setters mark them dirty
+	PushModelTests::TestPushBased(*this, ATeamGameState::StaticClass());
+	PushModelTests::TestPushBased(*this, UCombatStateComponent::StaticClass());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPushModelTeamGameStateSettersTest, "FirstPerson.Net.PushModel.TeamGameStateSetters",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPushModelTeamGameStateSettersTest::RunTest(const FString& Parameters)
+{
+	// push based properties are only written through setters, so they have to keep the state right on their own
+	FScopedTestGameWorld World;
+
+	ATeamGameState* GameState = World->SpawnActor<ATeamGameState>();
+
+	if (TestNotNull(TEXT("Game state spawned"), GameState))
+	{
+		GameState->AddScore(1, 3);
+		GameState->AddScore(2, 5);
+		TestEqual(TEXT("Score added to the blue team"), GameState->TeamScores[1], 3);
+		TestEqual(TEXT("Scores for teams that don't exist are ignored"), GameState->TeamScores.Num(), 2);
+
+		GameState->SetRemainingTime(120.4f);
+		GameState->SetRemainingTime(120.1f);
+		TestEqual(TEXT("Remaining time is kept exactly between whole seconds"), GameState->RemainingTime, 120.1f);
+
+		GameState->SetGameEnded(true);
+		TestTrue(TEXT("Game ended"), GameState->bGameEnded);
+
+		// pickups on either side of a bitfield word boundary
+		GameState->SetPickupConsumed(31, true);
+		GameState->SetPickupConsumed(32, true);
+		GameState->SetPickupConsumed(31, false);
+
+		TestFalse(TEXT("Pickup 31 respawned"), GameState->IsPickupConsumed(31));
+		TestTrue(TEXT("Pickup 32 consumed"), GameState->IsPickupConsumed(32));
+		TestFalse(TEXT("Pickups past the bitfield are available"), GameState->IsPickupConsumed(100));
+		TestEqual(TEXT("Bitfield only grows to the highest consumed pickup"), GameState->ConsumedPickups.Num(), 2);
+	}
+
+	return true;
+}
+
+#endif
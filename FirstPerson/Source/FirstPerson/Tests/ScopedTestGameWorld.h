@@ -0,0 +1,44 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ *  A bare game world for automation tests
+ *  Registered with the engine while in scope, so world subsystems and spawned actors behave as in a game.
+ *  Play isn't begun, so tests drive the actors themselves.
+ */
+class FScopedTestGameWorld
+{
+	UWorld* World = nullptr;
+
+public:
+
+	FScopedTestGameWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+	}
+
+	~FScopedTestGameWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	UE_NONCOPYABLE(FScopedTestGameWorld);
+
+	/** Returns the world */
+	UWorld* Get() const { return World; }
+
+	UWorld* operator->() const { return World; }
+};
+
+#endif
@@ -0,0 +1,227 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponFirePolicies.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ShooterFirePolicyTests
+{
+	/** Stands in for the weapon. Every call the per shot path makes only bumps a counter */
+	struct FStubWeapon
+	{
+		int32 CurrentBullets = 30;
+		int32 MagazineSize = 30;
+		int32 ShotsThisTrigger = 0;
+		int32 BurstCount = 1;
+		bool bFullAuto = false;
+		bool bInfiniteAmmo = false;
+		EShooterFireMode FireMode = EShooterFireMode::Projectile;
+
+		static constexpr int32 NumFireModes = 3;
+
+		int32 NumDeliveries[NumFireModes] = {};
+		int32 NumShots = 0;
+		int32 NumKeepFiring = 0;
+
+		bool HasAuthority() const { return true; }
+		float GetShotAge(float ShotTime) const { return 0.0f; }
+		FTransform CalculateProjectileSpawnTransform(const FVector& MuzzleLocation, const FVector& TargetLocation) const { return FTransform(MuzzleLocation); }
+		void RecordShot(float ShotTime) { ++NumShots; }
+		void FinishShot(bool bKeepFiring) { NumKeepFiring += bKeepFiring ? 1 : 0; }
+	};
+
+	/** Counts the shots delivered in a fire mode */
+	template<EShooterFireMode FireMode>
+	struct TStubDelivery
+	{
+		static constexpr bool bDeliversOnClients = FireMode != EShooterFireMode::Projectile;
+
+		static FORCEINLINE void Deliver(FStubWeapon& Weapon, const FTransform& ShotTransform, float ShotAge) { ++Weapon.NumDeliveries[static_cast<int32>(FireMode)]; }
+	};
+
+	using FStubSelector = TShooterFirePolicySelector<FStubWeapon, TStubDelivery<EShooterFireMode::Projectile>, TStubDelivery<EShooterFireMode::Hitscan>, TStubDelivery<EShooterFireMode::Spread>>;
+
+	/** The weapon's per shot path before the fire policies: one shot function for every weapon, branching on its settings */
+	bool RuntimeBranchFireShot(FStubWeapon& Weapon, const FVector& MuzzleLocation, const FVector& TargetLocation, float ShotTime)
+	{
+		const FTransform ShotTransform = Weapon.CalculateProjectileSpawnTransform(MuzzleLocation, TargetLocation);
+		const float ShotAge = Weapon.GetShotAge(ShotTime);
+
+		if (Weapon.FireMode == EShooterFireMode::Hitscan)
+		{
+			TStubDelivery<EShooterFireMode::Hitscan>::Deliver(Weapon, ShotTransform, ShotAge);
+
+		} else if (Weapon.FireMode == EShooterFireMode::Spread) {
+
+			TStubDelivery<EShooterFireMode::Spread>::Deliver(Weapon, ShotTransform, ShotAge);
+
+		} else if (Weapon.HasAuthority()) {
+
+			TStubDelivery<EShooterFireMode::Projectile>::Deliver(Weapon, ShotTransform, ShotAge);
+		}
+
+		Weapon.RecordShot(ShotTime);
+
+		if (!Weapon.bInfiniteAmmo)
+		{
+			FShooterMagazineAmmo::Consume(Weapon.CurrentBullets, Weapon.MagazineSize);
+		}
+
+		++Weapon.ShotsThisTrigger;
+		const bool bKeepFiring = Weapon.bFullAuto || Weapon.ShotsThisTrigger < Weapon.BurstCount;
+
+		Weapon.FinishShot(bKeepFiring);
+
+		return bKeepFiring;
+	}
+
+	/** Fires shots through a shot function and returns the cycles they took. Out of line so the call stays indirect, as it is on the weapon */
+	FORCENOINLINE uint64 TimeShots(FStubWeapon& Weapon, FStubSelector::FFireShotFunction FireShotFunction, int32 NumShots)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 Shot = 0; Shot < NumShots; ++Shot)
+		{
+			// every shot starts a new trigger pull, so bursts go through their whole sequence
+			Weapon.ShotsThisTrigger = Shot % FMath::Max(1, Weapon.BurstCount);
+			FireShotFunction(Weapon, FVector::ZeroVector, FVector::ForwardVector, 0.0f);
+		}
+
+		return FPlatformTime::Cycles64() - StartCycles;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterFirePolicySelectionTest, "FirstPerson.Weapons.FirePolicies.Selection",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterFirePolicySelectionTest::RunTest(const FString& Parameters)
+{
+	// full auto wins over the burst count, and a burst of one is a semi auto trigger
+	TestTrue(TEXT("Full auto projectile"), SelectShooterFirePolicy(true, 3, EShooterFireMode::Projectile, false) == &TShooterFirePolicy<FShooterFullAutoTrigger, FShooterProjectileDelivery, FShooterMagazineAmmo>::FireShot);
+	TestTrue(TEXT("Burst hitscan"), SelectShooterFirePolicy(false, 3, EShooterFireMode::Hitscan, false) == &TShooterFirePolicy<FShooterBurstTrigger, FShooterHitscanDelivery, FShooterMagazineAmmo>::FireShot);
+	TestTrue(TEXT("Semi auto spread"), SelectShooterFirePolicy(false, 1, EShooterFireMode::Spread, false) == &TShooterFirePolicy<FShooterSemiAutoTrigger, FShooterSpreadDelivery, FShooterMagazineAmmo>::FireShot);
+	TestTrue(TEXT("Infinite ammo"), SelectShooterFirePolicy(false, 1, EShooterFireMode::Projectile, true) == &TShooterFirePolicy<FShooterSemiAutoTrigger, FShooterProjectileDelivery, FShooterInfiniteAmmo>::FireShot);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterFirePolicyAdvanceTest, "FirstPerson.Weapons.FirePolicies.Advance",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterFirePolicyAdvanceTest::RunTest(const FString& Parameters)
+{
+	// a three round burst keeps firing until its third shot
+	{
+		using FPolicy = TShooterFirePolicy<FShooterBurstTrigger, FShooterHitscanDelivery, FShooterMagazineAmmo>;
+
+		int32 Bullets = 10;
+		int32 ShotsThisTrigger = 0;
+
+		TestTrue(TEXT("Burst shot 1 keeps firing"), FPolicy::Advance(Bullets, 10, ShotsThisTrigger, 3));
+		TestTrue(TEXT("Burst shot 2 keeps firing"), FPolicy::Advance(Bullets, 10, ShotsThisTrigger, 3));
+		TestFalse(TEXT("Burst shot 3 stops"), FPolicy::Advance(Bullets, 10, ShotsThisTrigger, 3));
+		TestEqual(TEXT("Burst used three bullets"), Bullets, 7);
+	}
+
+	// the magazine reloads once its last bullet is fired
+	{
+		using FPolicy = TShooterFirePolicy<FShooterSemiAutoTrigger, FShooterProjectileDelivery, FShooterMagazineAmmo>;
+
+		int32 Bullets = 2;
+		int32 ShotsThisTrigger = 0;
+
+		TestFalse(TEXT("Semi auto stops after one shot"), FPolicy::Advance(Bullets, 5, ShotsThisTrigger, 1));
+		TestEqual(TEXT("One bullet left"), Bullets, 1);
+
+		FPolicy::Advance(Bullets, 5, ShotsThisTrigger, 1);
+		TestEqual(TEXT("Magazine reloaded"), Bullets, 5);
+	}
+
+	// infinite ammo never takes a bullet, and full auto never stops
+	{
+		using FPolicy = TShooterFirePolicy<FShooterFullAutoTrigger, FShooterSpreadDelivery, FShooterInfiniteAmmo>;
+
+		int32 Bullets = 3;
+		int32 ShotsThisTrigger = 0;
+
+		for (int32 Shot = 0; Shot < 10; ++Shot)
+		{
+			TestTrue(TEXT("Full auto keeps firing"), FPolicy::Advance(Bullets, 3, ShotsThisTrigger, 1));
+		}
+
+		TestEqual(TEXT("No bullets taken"), Bullets, 3);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterFirePolicyBenchmarkTest, "FirstPerson.Weapons.FirePolicies.Benchmark",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FShooterFirePolicyBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace ShooterFirePolicyTests;
+
+	constexpr int32 NumRounds = 4;
+	constexpr int32 ShotsPerRound = 25000;
+
+	const double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.0e9;
+
+	// semi auto, three round burst and full auto triggers
+	const TPair<bool, int32> Triggers[] = { { false, 1 }, { false, 3 }, { true, 1 } };
+
+	for (const TPair<bool, int32>& Trigger : Triggers)
+	{
+		for (const EShooterFireMode FireMode : { EShooterFireMode::Projectile, EShooterFireMode::Hitscan, EShooterFireMode::Spread })
+		{
+			for (const bool bInfiniteAmmo : { false, true })
+			{
+				FStubWeapon PolicyWeapon;
+				PolicyWeapon.bFullAuto = Trigger.Key;
+				PolicyWeapon.BurstCount = Trigger.Value;
+				PolicyWeapon.FireMode = FireMode;
+				PolicyWeapon.bInfiniteAmmo = bInfiniteAmmo;
+
+				FStubWeapon RuntimeWeapon = PolicyWeapon;
+
+				const FStubSelector::FFireShotFunction PolicyFireShot = FStubSelector::Select(PolicyWeapon.bFullAuto, PolicyWeapon.BurstCount, FireMode, bInfiniteAmmo);
+
+				// alternate the two paths so neither one gets all the warm caches
+				uint64 PolicyCycles = 0;
+				uint64 RuntimeCycles = 0;
+
+				for (int32 Round = 0; Round < NumRounds; ++Round)
+				{
+					PolicyCycles += TimeShots(PolicyWeapon, PolicyFireShot, ShotsPerRound);
+					RuntimeCycles += TimeShots(RuntimeWeapon, &RuntimeBranchFireShot, ShotsPerRound);
+				}
+
+				const FString Name = FString::Printf(TEXT("%s %s%s"),
+					Trigger.Key ? TEXT("Full auto") : Trigger.Value > 1 ? TEXT("Burst") : TEXT("Semi auto"),
+					*UEnum::GetDisplayValueAsText(FireMode).ToString(),
+					bInfiniteAmmo ? TEXT(", infinite ammo") : TEXT(""));
+
+				// both paths have to do exactly the same work for the timings to compare
+				TestEqual(Name + TEXT(": shots"), PolicyWeapon.NumShots, RuntimeWeapon.NumShots);
+				TestEqual(Name + TEXT(": keep firing"), PolicyWeapon.NumKeepFiring, RuntimeWeapon.NumKeepFiring);
+				TestEqual(Name + TEXT(": bullets"), PolicyWeapon.CurrentBullets, RuntimeWeapon.CurrentBullets);
+
+				for (int32 Mode = 0; Mode < FStubWeapon::NumFireModes; ++Mode)
+				{
+					TestEqual(FString::Printf(TEXT("%s: deliveries in mode %d"), *Name, Mode), PolicyWeapon.NumDeliveries[Mode], RuntimeWeapon.NumDeliveries[Mode]);
+				}
+
+				AddInfo(FString::Printf(TEXT("%s: policy %.2f ns/shot, runtime branches %.2f ns/shot"),
+					*Name,
+					PolicyCycles * NsPerCycle / (NumRounds * ShotsPerRound),
+					RuntimeCycles * NsPerCycle / (NumRounds * ShotsPerRound)));
+			}
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "SimpleTreasure.h"
+#include "ShooterPickup.h"
+#include "ScopedTestGameWorld.h"
+#include "GameFramework/Pawn.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleTreasureDormancyTest, "FirstPerson.Net.Dormancy.Treasure",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSimpleTreasureDormancyTest::RunTest(const FString& Parameters)
+{
+	const ASimpleTreasure* Default = GetDefault<ASimpleTreasure>();
+
+	TestTrue(TEXT("Treasure replicates"), Default->GetIsReplicated());
+	TestTrue(TEXT("Treasure starts initially dormant"), Default->GetNetDormancy() == DORM_Initial);
+
+	FScopedTestGameWorld World;
+
+	ASimpleTreasure* Treasure = World->SpawnActor<ASimpleTreasure>();
+	APawn* Pawn = World->SpawnActor<APawn>();
+
+	if (TestNotNull(TEXT("Treasure"), Treasure) && TestNotNull(TEXT("Pawn"), Pawn))
+	{
+		TestTrue(TEXT("Spawned treasure is initially dormant"), Treasure->GetNetDormancy() == DORM_Initial);
+
+		// spinning in place doesn't touch replicated state
+		Treasure->Tick(1.0f);
+
+		TestTrue(TEXT("Ticking treasure stays dormant"), Treasure->GetNetDormancy() == DORM_Initial);
+		TestEqual(TEXT("Ticking treasure doesn't flush"), Treasure->NumDormancyFlushes, 0);
+
+		// only players collect treasure
+		const FVector Location = Treasure->GetActorLocation();
+		Treasure->OnPawnEntered(Pawn);
+
+		TestTrue(TEXT("Treasure entered by a non-player stays dormant"), Treasure->GetNetDormancy() == DORM_Initial);
+		TestEqual(TEXT("Treasure entered by a non-player doesn't flush"), Treasure->NumDormancyFlushes, 0);
+		TestEqual(TEXT("Treasure entered by a non-player stays in place"), Treasure->GetActorLocation(), Location);
+
+		// the teleport after a pickup flushes once, then the treasure goes back to sleep
+		Treasure->Teleport();
+
+		TestEqual(TEXT("Teleport flushes once"), Treasure->NumDormancyFlushes, 1);
+		TestTrue(TEXT("Teleported treasure is dormant again"), Treasure->GetNetDormancy() == DORM_DormantAll);
+
+		Treasure->Tick(1.0f);
+
+		TestTrue(TEXT("Teleported treasure stays dormant while ticking"), Treasure->GetNetDormancy() == DORM_DormantAll);
+		TestEqual(TEXT("Ticking teleported treasure doesn't flush"), Treasure->NumDormancyFlushes, 1);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterPickupReplicationTest, "FirstPerson.Net.Dormancy.Pickup",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterPickupReplicationTest::RunTest(const FString& Parameters)
+{
+	// pickup availability replicates through the team game state, so the pickup itself has no dormancy to manage
+	TestFalse(TEXT("Pickup doesn't replicate"), GetDefault<AShooterPickup>()->GetIsReplicated());
+
+	return true;
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 	#include "Variant_Shooter/AI/ShooterNPC.h"
 	#include "ShooterWeapon.h"
+	#include "ShooterAimTargetComponent.h"
 	#include "Components/SkeletalMeshComponent.h"
 	#include "Camera/CameraComponent.h"
 	#include "Kismet/KismetMathLibrary.h"
@@ -12,10 +13,30 @@
 	#include "GameFramework/CharacterMovementComponent.h"
 	#include "TimerManager.h"
 
+	AShooterNPC::AShooterNPC()
+	{
+		// create the aim target cache
+		AimCache = CreateDefaultSubobject<UShooterAimTargetComponent>(TEXT("Aim Target"));
+	}
+
+	void AShooterNPC::PostInitializeComponents()
+	{
+		Super::PostInitializeComponents();
+
+		// the starting HP is the max health
+		GetCombatState()->SetMaxHealth(CurrentHP);
+	}
+
 	void AShooterNPC::BeginPlay()
 	{
 		Super::BeginPlay();
 
+		// the server spawns the weapon. It replicates to clients
+		if (!HasAuthority())
+		{
+			return;
+		}
+
 		// spawn the weapon
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Owner = this;
@@ -36,19 +57,16 @@
 	float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 	{
 		// ignore if already dead
-		if (bIsDead)
+		if (IsKilled())
 		{
 			return 0.0f;
 		}
 
-		// Reduce HP
-		CurrentHP -= Damage;
-		// ֱӸѪ޹㲥
-		//FString healthMessage = FString::Printf(TEXT("You now have %f health remaining."), CurrentHP);
-		//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
-		UpdateHealthBar(); //  һ
+		// Reduce HP. The health bar is updated from OnCombatStateChanged
+		const float RemainingHP = GetCombatState()->ApplyDamage(Damage, EventInstigator);
+
 		// Have we depleted HP?
-		if (CurrentHP <= 0.0f)
+		if (RemainingHP <= 0.0f)
 		{
 			Die();
 		}
@@ -111,19 +129,21 @@
 
 		}
 
-		// calculate the unobstructed aim target location
-		AimTarget = AimSource + (AimDir * AimRange);
+		// the cached aim trace tells us how far the aim ray is clear. Scatter the shot over that distance
+		const float AimDistance = FVector::Dist(AimSource, AimCache->GetAimTargetLocation());
 
-		// run a visibility trace to see if there's obstructions
-		FHitResult OutHit;
+		return AimSource + (AimDir * AimDistance);
+	}
 
-		FCollisionQueryParams QueryParams;
-		QueryParams.AddIgnoredActor(this);
+	void AShooterNPC::GetWeaponAimRay(FVector& OutStart, FVector& OutEnd)
+	{
+		// aim from the camera location
+		OutStart = GetFirstPersonCameraComponent()->GetComponentLocation();
 
-		GetWorld()->LineTraceSingleByChannel(OutHit, AimSource, AimTarget, ECC_Visibility, QueryParams);
+		// towards the aim target's center, or along the camera facing without one
+		const FVector AimDir = CurrentAimTarget ? (CurrentAimTarget->GetActorLocation() - OutStart).GetSafeNormal() : GetFirstPersonCameraComponent()->GetForwardVector();
 
-		// return either the impact point or the trace end
-		return OutHit.bBlockingHit ? OutHit.ImpactPoint : OutHit.TraceEnd;
+		OutEnd = OutStart + (AimDir * AimRange);
 	}
 
 	void AShooterNPC::AddWeaponClass(const TSubclassOf<AShooterWeapon>& InWeaponClass)
@@ -154,13 +174,13 @@
 	void AShooterNPC::Die()
 	{
 		// ignore if already dead
-		if (bIsDead)
+		if (IsKilled())
 		{
 			return;
 		}
 
-		// raise the dead flag
-		bIsDead = true;
+		// raise the replicated dead flag
+		GetCombatState()->SetDead();
 
 		// increment the team score
 		if (AShooterGameMode* GM = Cast<AShooterGameMode>(GetWorld()->GetAuthGameMode()))
@@ -184,6 +204,16 @@
 		GetWorld()->GetTimerManager().SetTimer(DeathTimer, this, &AShooterNPC::DeferredDestruction, DeferredDestructionTime, false);
 	}
 
+	void AShooterNPC::OnCombatStateChanged(const FCombatState& PreviousState)
+	{
+		// death is handled through the ragdoll instead of the first person death camera, so only the health bar needs updating
+		if (PreviousState.Health != GetCombatState()->GetState().Health)
+		{
+			CurrentHP = GetCurrentHealth();
+			UpdateHealthBar();
+		}
+	}
+
 	void AShooterNPC::DeferredDestruction()
 	{
 		Destroy();
@@ -10,6 +10,7 @@
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnDeathDelegate);
 
 class AShooterWeapon;
+class UShooterAimTargetComponent;
 
 /**
  *  A simple AI-controlled shooter game NPC
@@ -21,9 +22,13 @@ class FIRSTPERSON_API AShooterNPC : public AFirstPersonCharacter, public IShoote
 {
 	GENERATED_BODY()
 
+	/** Aim target cache for the weapon */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterAimTargetComponent* AimCache;
+
 public:
 
-	/** Current HP for this character. It dies if it reaches zero through damage */
+	/** Current HP for this character. It dies if it reaches zero through damage. Sets the max health, then mirrors the replicated combat state */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage")
 	float CurrentHP = 100.0f;
 
@@ -78,9 +83,6 @@ protected:
 	/** If true, this character is currently shooting its weapon */
 	bool bIsShooting = false;
 
-	/** If true, this character has already died */
-	bool bIsDead = false;
-
 	/** Deferred destruction on death timer */
 	FTimerHandle DeathTimer;
 
@@ -91,8 +93,16 @@ public:
 	/** Delegate called when this NPC dies */
 	FPawnDeathDelegate OnPawnDeath;
 
+public:
+
+	/** Constructor */
+	AShooterNPC();
+
 protected:
 
+	/** Sets the combat state's max health from the starting HP */
+	virtual void PostInitializeComponents() override;
+
 	/** Gameplay initialization */
 	virtual void BeginPlay() override;
 
@@ -123,6 +133,9 @@ public:
 	/** Calculates and returns the aim location for the weapon */
 	virtual FVector GetWeaponTargetLocation() override;
 
+	/** Returns the unobstructed ray the owner aims along, for aim traces */
+	virtual void GetWeaponAimRay(FVector& OutStart, FVector& OutEnd) override;
+
 	/** Gives a weapon of this class to the owner */
 	virtual void AddWeaponClass(const TSubclassOf<AShooterWeapon>& WeaponClass) override;
 
@@ -142,6 +155,9 @@ protected:
 	/** Called when HP is depleted and the character should die */
 	void Die();
 
+	/** Updates the health bar when the combat state changes */
+	virtual void OnCombatStateChanged(const FCombatState& PreviousState) override;
+
 	/** Called after death to destroy the actor */
 	void DeferredDestruction();
 
@@ -3,22 +3,31 @@
 
 #include "ShooterCharacter.h"
 #include "ShooterWeapon.h"
+#include "ShooterAimTargetComponent.h"
 #include "EnhancedInputComponent.h"
 #include "Components/InputComponent.h"
 #include "Components/PawnNoiseEmitterComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
 #include "Camera/CameraComponent.h"
 #include "TimerManager.h"
 #include "ShooterGameMode.h"
+#include "FirstPerson.h"
 #include <Net/UnrealNetwork.h>
 
+DECLARE_CYCLE_STAT(TEXT("Weapon Switch"), STAT_WeaponSwitch, STATGROUP_FirstPerson);
+DECLARE_CYCLE_STAT(TEXT("Weapon Anim Switch"), STAT_WeaponAnimSwitch, STATGROUP_FirstPerson);
+
 AShooterCharacter::AShooterCharacter()
 {
 	// create the noise emitter component
 	PawnNoiseEmitter = CreateDefaultSubobject<UPawnNoiseEmitterComponent>(TEXT("Pawn Noise Emitter"));
 
+	// create the aim target cache
+	AimCache = CreateDefaultSubobject<UShooterAimTargetComponent>(TEXT("Aim Target"));
+
 	// configure movement
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 600.0f, 0.0f);
 }
@@ -26,16 +35,21 @@ AShooterCharacter::AShooterCharacter()
 void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	DOREPLIFETIME(AShooterCharacter, CurrentHP);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, CurrentWeapon, COND_OwnerOnly);
+}
+
+void AShooterCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// start at full HP
+	GetCombatState()->SetMaxHealth(MaxHP);
 }
 
 void AShooterCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// reset HP to max
-	CurrentHP = MaxHP;
-
 	// update the HUD
 	OnDamaged.Broadcast(1.0f);
 }
@@ -69,23 +83,20 @@ void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 float AShooterCharacter::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	// ignore if already dead
-	if (CurrentHP <= 0.0f)
+	if (IsKilled())
 	{
 		return 0.0f;
 	}
 
-	// Reduce HP
-	CurrentHP -= Damage;
+	// Reduce HP. The HUD is updated from OnCombatStateChanged
+	const float RemainingHP = GetCombatState()->ApplyDamage(Damage, EventInstigator);
 
 	// Have we depleted HP?
-	if (CurrentHP <= 0.0f)
+	if (RemainingHP <= 0.0f)
 	{
 		Die();
 	}
 
-	// update the HUD
-	OnDamaged.Broadcast(FMath::Max(0.0f, CurrentHP / MaxHP));
-
 	return Damage;
 }
 
@@ -109,34 +120,26 @@ void AShooterCharacter::DoStopFiring()
 
 void AShooterCharacter::DoSwitchWeapon()
 {
-	// ensure we have at least two weapons two switch between
-	if (OwnedWeapons.Num() > 1)
+	// the inventory lives on the server
+	if (!HasAuthority())
 	{
-		// deactivate the old weapon
-		CurrentWeapon->DeactivateWeapon();
-
-		// find the index of the current weapon in the owned list
-		int32 WeaponIndex = OwnedWeapons.Find(CurrentWeapon);
-
-		// is this the last weapon?
-		if (WeaponIndex == OwnedWeapons.Num() - 1)
-		{
-			// loop back to the beginning of the array
-			WeaponIndex = 0;
-		}
-		else {
-			// select the next weapon index
-			++WeaponIndex;
-		}
-
-		// set the new weapon as current
-		CurrentWeapon = OwnedWeapons[WeaponIndex];
+		ServerSwitchWeapon();
+		return;
+	}
 
-		// activate the new weapon
-		CurrentWeapon->ActivateWeapon();
+	// ensure we have at least two weapons two switch between
+	if (WeaponSlots.Num() > 1)
+	{
+		// select the next slot, looping back to the beginning
+		EquipWeaponSlot((CurrentWeaponSlot + 1) % WeaponSlots.Num());
 	}
 }
 
+void AShooterCharacter::ServerSwitchWeapon_Implementation()
+{
+	DoSwitchWeapon();
+}
+
 void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
 {
 	const FAttachmentTransformRules AttachmentRule(EAttachmentRule::SnapToTarget, false);
@@ -168,53 +171,59 @@ void AShooterCharacter::UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize)
 
 FVector AShooterCharacter::GetWeaponTargetLocation()
 {
-	// trace ahead from the camera viewpoint
-	FHitResult OutHit;
-
-	const FVector Start = GetFirstPersonCameraComponent()->GetComponentLocation();
-	const FVector End = Start + (GetFirstPersonCameraComponent()->GetForwardVector() * MaxAimDistance);
-
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
-
-	GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
+	// read the cached aim trace, projected on the current camera ray
+	return AimCache->GetAimTargetLocation();
+}
 
-	// return either the impact point or the trace end
-	return OutHit.bBlockingHit ? OutHit.ImpactPoint : OutHit.TraceEnd;
+void AShooterCharacter::GetWeaponAimRay(FVector& OutStart, FVector& OutEnd)
+{
+	// aim ahead from the camera viewpoint
+	OutStart = GetFirstPersonCameraComponent()->GetComponentLocation();
+	OutEnd = OutStart + (GetFirstPersonCameraComponent()->GetForwardVector() * MaxAimDistance);
 }
 
 void AShooterCharacter::AddWeaponClass(const TSubclassOf<AShooterWeapon>& WeaponClass)
 {
+	// only the server grants weapons. The weapon actor replicates to clients
+	if (!HasAuthority())
+	{
+		return;
+	}
+
 	// do we already own this weapon?
-	AShooterWeapon* OwnedWeapon = FindWeaponOfType(WeaponClass);
+	if (!WeaponClass || FindWeaponSlot(WeaponClass) != INDEX_NONE)
+	{
+		return;
+	}
 
-	if (!OwnedWeapon)
+	// the first pickup spawns the one weapon actor we'll ever need
+	if (!CurrentWeapon)
 	{
-		// spawn the new weapon
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Owner = this;
 		SpawnParams.Instigator = this;
 		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 		SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::MultiplyWithRoot;
 
-		AShooterWeapon* AddedWeapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, GetActorTransform(), SpawnParams);
+		CurrentWeapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, GetActorTransform(), SpawnParams);
 
-		if (AddedWeapon)
+		if (!CurrentWeapon)
 		{
-			// add the weapon to the owned list
-			OwnedWeapons.Add(AddedWeapon);
-
-			// if we have an existing weapon, deactivate it
-			if (CurrentWeapon)
-			{
-				CurrentWeapon->DeactivateWeapon();
-			}
-
-			// switch to the new weapon
-			CurrentWeapon = AddedWeapon;
-			CurrentWeapon->ActivateWeapon();
+			return;
 		}
 	}
+
+	// add a slot with a full magazine
+	const int32 SlotIndex = WeaponSlots.Num();
+
+	FShooterWeaponSlot& Slot = WeaponSlots.AddDefaulted_GetRef();
+	Slot.WeaponClass = WeaponClass;
+	Slot.Bullets = WeaponClass->GetDefaultObject<AShooterWeapon>()->GetMagazineSize();
+
+	WeaponSlotIndices.Add(WeaponClass, SlotIndex);
+
+	// switch to the new weapon
+	EquipWeaponSlot(SlotIndex);
 }
 
 void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
@@ -222,9 +231,11 @@ void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
 	// update the bullet counter
 	OnBulletCountUpdated.Broadcast(Weapon->GetMagazineSize(), Weapon->GetBulletCount());
 
+	SCOPE_CYCLE_COUNTER(STAT_WeaponAnimSwitch);
+
 	// set the character mesh AnimInstances
-	GetFirstPersonMesh()->SetAnimInstanceClass(Weapon->GetFirstPersonAnimInstanceClass());
-	GetMesh()->SetAnimInstanceClass(Weapon->GetThirdPersonAnimInstanceClass());
+	ApplyWeaponAnimation(GetFirstPersonMesh(), Weapon->GetFirstPersonAnimInstanceClass(), Weapon->ShouldLinkAnimLayers(), LinkedFirstPersonAnimLayers);
+	ApplyWeaponAnimation(GetMesh(), Weapon->GetThirdPersonAnimInstanceClass(), Weapon->ShouldLinkAnimLayers(), LinkedThirdPersonAnimLayers);
 }
 
 void AShooterCharacter::OnWeaponDeactivated(AShooterWeapon* Weapon)
@@ -237,24 +248,82 @@ void AShooterCharacter::OnSemiWeaponRefire()
 	// unused
 }
 
-AShooterWeapon* AShooterCharacter::FindWeaponOfType(TSubclassOf<AShooterWeapon> WeaponClass) const
+int32 AShooterCharacter::FindWeaponSlot(TSubclassOf<AShooterWeapon> WeaponClass) const
+{
+	const int32* SlotIndex = WeaponSlotIndices.Find(WeaponClass);
+	return SlotIndex ? *SlotIndex : INDEX_NONE;
+}
+
+void AShooterCharacter::EquipWeaponSlot(int32 SlotIndex)
 {
-	// check each owned weapon
-	for (AShooterWeapon* Weapon : OwnedWeapons)
+	SCOPE_CYCLE_COUNTER(STAT_WeaponSwitch);
+
+	// deactivate the old weapon and keep its state
+	if (WeaponSlots.IsValidIndex(CurrentWeaponSlot))
 	{
-		if (Weapon->IsA(WeaponClass))
+		CurrentWeapon->DeactivateWeapon();
+		CurrentWeapon->SaveWeaponSlot(WeaponSlots[CurrentWeaponSlot]);
+	}
+
+	CurrentWeaponSlot = SlotIndex;
+
+	// reconfigure the weapon actor for the new slot and activate it
+	CurrentWeapon->LoadWeaponSlot(WeaponSlots[SlotIndex]);
+	CurrentWeapon->ActivateWeapon();
+}
+
+void AShooterCharacter::ApplyWeaponAnimation(USkeletalMeshComponent* Mesh, TSubclassOf<UAnimInstance> AnimClass, bool bLinkAnimLayers, TSubclassOf<UAnimInstance>& LinkedAnimLayers)
+{
+	if (bLinkAnimLayers)
+	{
+		// layers link into the character's own AnimInstance. Restore it if a previous weapon replaced it
+		const TSubclassOf<UAnimInstance> BaseAnimClass = CastChecked<USkeletalMeshComponent>(Mesh->GetArchetype())->GetAnimClass();
+
+		if (Mesh->GetAnimClass() != BaseAnimClass)
 		{
-			return Weapon;
+			Mesh->SetAnimInstanceClass(BaseAnimClass);
+			LinkedAnimLayers = nullptr;
 		}
-	}
 
-	// weapon not found
-	return nullptr;
+		// relink only when the layers change
+		if (LinkedAnimLayers != AnimClass)
+		{
+			if (LinkedAnimLayers)
+			{
+				Mesh->UnlinkAnimClassLayers(LinkedAnimLayers);
+			}
+
+			if (AnimClass)
+			{
+				Mesh->LinkAnimClassLayers(AnimClass);
+			}
+
+			LinkedAnimLayers = AnimClass;
+		}
+
+	} else {
+
+		// drop the previous weapon's layers
+		if (LinkedAnimLayers)
+		{
+			Mesh->UnlinkAnimClassLayers(LinkedAnimLayers);
+			LinkedAnimLayers = nullptr;
+		}
 
+		// weapons sharing an AnimInstance class keep the running instance
+		if (Mesh->GetAnimClass() != AnimClass)
+		{
+			Mesh->SetAnimInstanceClass(AnimClass);
+		}
+	}
 }
 
 void AShooterCharacter::Die()
 {
+	// raise the replicated death flag
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	GetCombatState()->SetDead(GameState ? GameState->GetServerWorldTimeSeconds() + RespawnTime : 0.0);
+
 	// deactivate the weapon
 	if (IsValid(CurrentWeapon))
 	{
@@ -288,3 +357,12 @@ void AShooterCharacter::OnRespawn()
 	// destroy the character to force the PC to respawn
 	Destroy();
 }
+
+void AShooterCharacter::OnCombatStateChanged(const FCombatState& PreviousState)
+{
+	// death plays through BP_OnDeath instead of the first person death camera, so only the HUD needs updating
+	if (PreviousState.Health != GetCombatState()->GetState().Health)
+	{
+		OnDamaged.Broadcast(GetCombatState()->GetHealthFraction());
+	}
+}
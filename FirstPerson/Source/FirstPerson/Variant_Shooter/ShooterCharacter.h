@@ -5,12 +5,14 @@
 #include "CoreMinimal.h"
 #include "FirstPersonCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterWeapon.h"
 #include "ShooterCharacter.generated.h"
 
 class AShooterWeapon;
 class UInputAction;
 class UInputComponent;
 class UPawnNoiseEmitterComponent;
+class UShooterAimTargetComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBulletCountUpdatedDelegate, int32, MagazineSize, int32, Bullets);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent);
@@ -29,6 +31,10 @@ class FIRSTPERSON_API AShooterCharacter : public AFirstPersonCharacter, public I
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UPawnNoiseEmitterComponent* PawnNoiseEmitter;
 
+	/** Aim target cache shared by the weapon and the crosshair */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterAimTargetComponent* AimCache;
+
 protected:
 
 	/** Fire weapon input action */
@@ -54,18 +60,28 @@ protected:
 	/** Max HP this character can have */
 	UPROPERTY(EditAnywhere, Category="Health")
 	float MaxHP = 500.0f;
-	/** ҵĵǰֵ0ͱʾ*/
-	/** Current HP remaining to this character */
-	float CurrentHP = 0.0f;
-	/** RepNotifyͬԵǰֵĸġ*/
+
 	/** Team ID for this character*/
 	UPROPERTY(EditAnywhere, Category="Team")
 	uint8 TeamByte = 0;
 
-	/** List of weapons picked up by the character */
-	TArray<AShooterWeapon*> OwnedWeapons;
+	/** Weapons picked up by the character, in pickup order */
+	TArray<FShooterWeaponSlot> WeaponSlots;
+
+	/** Index into the weapon slots for each owned weapon class */
+	TMap<TSubclassOf<AShooterWeapon>, int32> WeaponSlotIndices;
 
-	/** Weapon currently equipped and ready to shoot with */
+	/** Index of the slot the weapon actor is currently showing */
+	int32 CurrentWeaponSlot = INDEX_NONE;
+
+	/** Anim layer class currently linked into the first person mesh, if any */
+	TSubclassOf<UAnimInstance> LinkedFirstPersonAnimLayers;
+
+	/** Anim layer class currently linked into the third person mesh, if any */
+	TSubclassOf<UAnimInstance> LinkedThirdPersonAnimLayers;
+
+	/** The one weapon actor, reconfigured for whichever slot is equipped. Replicated so the owner can drive it from input */
+	UPROPERTY(Replicated)
 	TObjectPtr<AShooterWeapon> CurrentWeapon;
 
 	UPROPERTY(EditAnywhere, Category ="Destruction", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
@@ -89,6 +105,9 @@ public:
 		OutLifetimeProps) const override;
 protected:
 
+	/** Sets the combat state's max health from MaxHP */
+	virtual void PostInitializeComponents() override;
+
 	/** Gameplay initialization */
 	virtual void BeginPlay() override;
 
@@ -117,6 +136,12 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Input")
 	void DoSwitchWeapon();
 
+protected:
+
+	/** Switches weapons on the server, which owns the inventory */
+	UFUNCTION(Server, Reliable)
+	void ServerSwitchWeapon();
+
 public:
 
 	//~Begin IShooterWeaponHolder interface
@@ -136,6 +161,9 @@ public:
 	/** Calculates and returns the aim location for the weapon */
 	virtual FVector GetWeaponTargetLocation() override;
 
+	/** Returns the unobstructed ray the owner aims along, for aim traces */
+	virtual void GetWeaponAimRay(FVector& OutStart, FVector& OutEnd) override;
+
 	/** Gives a weapon of this class to the owner */
 	virtual void AddWeaponClass(const TSubclassOf<AShooterWeapon>& WeaponClass) override;
 
@@ -152,12 +180,21 @@ public:
 
 protected:
 
-	/** Returns true if the character already owns a weapon of the given class */
-	AShooterWeapon* FindWeaponOfType(TSubclassOf<AShooterWeapon> WeaponClass) const;
+	/** Returns the slot index of an owned weapon class, or INDEX_NONE if it's not owned */
+	int32 FindWeaponSlot(TSubclassOf<AShooterWeapon> WeaponClass) const;
+
+	/** Stores the current weapon's state in its slot and reconfigures the weapon actor for another slot */
+	void EquipWeaponSlot(int32 SlotIndex);
+
+	/** Applies a weapon's animation to a mesh, relinking layers or swapping the AnimInstance class only if it changed */
+	static void ApplyWeaponAnimation(USkeletalMeshComponent* Mesh, TSubclassOf<UAnimInstance> AnimClass, bool bLinkAnimLayers, TSubclassOf<UAnimInstance>& LinkedAnimLayers);
 
 	/** Called when this character's HP is depleted */
 	void Die();
 
+	/** Updates the HUD when the combat state changes */
+	virtual void OnCombatStateChanged(const FCombatState& PreviousState) override;
+
 	/** Called to allow Blueprint code to react to this character's death */
 	UFUNCTION(BlueprintImplementableEvent, Category="Shooter", meta = (DisplayName = "On Death"))
 	void BP_OnDeath();
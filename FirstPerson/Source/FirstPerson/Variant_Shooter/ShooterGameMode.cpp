@@ -5,11 +5,25 @@
 #include "ShooterUI.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
+#include "TeamGameState.h"
+#include "FirstPerson.h"
+
+AShooterGameMode::AShooterGameMode()
+{
+	// the team game state also replicates pickup availability. Blueprints may still override it
+	GameStateClass = ATeamGameState::StaticClass();
+}
 
 void AShooterGameMode::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// pickups still respawn on the server without it, but clients never hear about them
+	if (!GetGameState<ATeamGameState>())
+	{
+		UE_LOG(LogFirstPerson, Warning, TEXT("%s uses %s, which doesn't derive from ATeamGameState. Pickup availability won't replicate"), *GetName(), *GetNameSafe(GameStateClass));
+	}
+
 	// create the UI
 	ShooterUI = CreateWidget<UShooterUI>(UGameplayStatics::GetPlayerController(GetWorld(), 0), ShooterUIClass);
 	ShooterUI->AddToViewport(0);
@@ -30,6 +30,16 @@ protected:
 	/** Map of scores by team ID */
 	TMap<uint8, int32> TeamScores;
 
+public:
+
+	/**
+	 *  Constructor
+	 *  Defaults the game state class to ATeamGameState, which replicates pickup availability to clients.
+	 *  BP_ShooterGameMode leaves the game state class at this default. Subclasses that pick their own game state
+	 *  should derive it from ATeamGameState, or remote clients won't see pickups being consumed.
+	 */
+	AShooterGameMode();
+
 protected:
 
 	/** Gameplay initialization */
@@ -0,0 +1,135 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAimTargetComponent.h"
+#include "ShooterWeaponHolder.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aim Traces Async"), STAT_AimTracesAsync, STATGROUP_FirstPerson);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aim Traces Sync"), STAT_AimTracesSync, STATGROUP_FirstPerson);
+
+UShooterAimTargetComponent::UShooterAimTargetComponent()
+{
+	// trace after the owner and its camera have moved
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UShooterAimTargetComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AimTraceDelegate.BindUObject(this, &UShooterAimTargetComponent::OnAimTraceCompleted);
+}
+
+void UShooterAimTargetComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// only the server and the owning client fire shots
+	if (GetOwnerRole() == ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	// one trace in flight at a time
+	if (GetWorld()->IsTraceHandleValid(PendingTrace, false))
+	{
+		return;
+	}
+
+	FVector Start, End;
+
+	if (!GetAimRay(Start, End))
+	{
+		return;
+	}
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AimTargetTrace), false, GetOwner());
+
+	PendingTraceTime = GetWorld()->GetTimeSeconds();
+	PendingTrace = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECC_Visibility, QueryParams, FCollisionResponseParams::DefaultResponseParam, &AimTraceDelegate);
+
+	INC_DWORD_STAT(STAT_AimTracesAsync);
+}
+
+FVector UShooterAimTargetComponent::GetAimTargetLocation(bool bExact)
+{
+	// serve a stale or missing result with a fresh trace
+	const float ResultAge = GetAimResultAge();
+
+	if (bExact || ResultAge < 0.0f || ResultAge > MaxResultAge)
+	{
+		ResolveAimNow();
+	}
+
+	FVector Start, End;
+
+	if (!GetAimRay(Start, End))
+	{
+		return AimResult.bBlockingHit ? AimResult.ImpactPoint : AimResult.TraceEnd;
+	}
+
+	// project the cached distance on the current aim ray
+	return Start + (End - Start).GetSafeNormal() * FMath::Min(AimDistance, FVector::Dist(Start, End));
+}
+
+float UShooterAimTargetComponent::GetAimResultAge() const
+{
+	return AimResultTime < 0.0 ? -1.0f : static_cast<float>(GetWorld()->GetTimeSeconds() - AimResultTime);
+}
+
+void UShooterAimTargetComponent::ResolveAimNow()
+{
+	FVector Start, End;
+
+	if (!GetAimRay(Start, End))
+	{
+		return;
+	}
+
+	FHitResult OutHit;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AimTargetTrace), false, GetOwner());
+	GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
+
+	StoreAimResult(OutHit, Start, End);
+
+	INC_DWORD_STAT(STAT_AimTracesSync);
+}
+
+bool UShooterAimTargetComponent::GetAimRay(FVector& OutStart, FVector& OutEnd) const
+{
+	if (IShooterWeaponHolder* Holder = Cast<IShooterWeaponHolder>(GetOwner()))
+	{
+		Holder->GetWeaponAimRay(OutStart, OutEnd);
+		return true;
+	}
+
+	return false;
+}
+
+void UShooterAimTargetComponent::StoreAimResult(const FHitResult& Hit, const FVector& Start, const FVector& End)
+{
+	AimResult = Hit;
+	AimResult.TraceStart = Start;
+	AimResult.TraceEnd = End;
+
+	AimDistance = Hit.bBlockingHit ? FVector::Dist(Start, Hit.ImpactPoint) : FVector::Dist(Start, End);
+	AimResultTime = GetWorld()->GetTimeSeconds();
+}
+
+void UShooterAimTargetComponent::OnAimTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	PendingTrace = FTraceHandle();
+
+	// a synchronous trace may have already refreshed the cache past this one
+	if (AimResultTime > PendingTraceTime)
+	{
+		return;
+	}
+
+	StoreAimResult(Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult(), Datum.Start, Datum.End);
+}
@@ -0,0 +1,89 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "ShooterAimTargetComponent.generated.h"
+
+/**
+ *  Caches where a weapon holder is aiming
+ *  Issues one async visibility trace per frame along the owner's aim ray and keeps the last result.
+ *  Weapon fire, the HUD crosshair and AI all read the cached aim distance projected on the current aim ray,
+ *  so turning between the trace and the read doesn't drag the aim point along.
+ *  Consumers that need exactness can ask for a fresh synchronous trace, which also refreshes the cache.
+ *  The owner must implement IShooterWeaponHolder to provide the aim ray.
+ */
+UCLASS(ClassGroup=(Shooter), meta=(BlueprintSpawnableComponent))
+class FIRSTPERSON_API UShooterAimTargetComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Oldest cached result that's still served. Older ones fall back to a synchronous trace */
+	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MaxResultAge = 0.1f;
+
+	/** Handle of the async trace in flight, if any */
+	FTraceHandle PendingTrace;
+
+	/** World time the async trace in flight was issued at */
+	double PendingTraceTime = 0.0;
+
+	/** Delegate called when the async trace completes */
+	FTraceDelegate AimTraceDelegate;
+
+	/** Last resolved aim trace */
+	FHitResult AimResult;
+
+	/** Distance along the aim ray to the last resolved aim point */
+	float AimDistance = 0.0f;
+
+	/** World time the cached result was traced at. Negative until the first trace resolves */
+	double AimResultTime = -1.0;
+
+public:
+
+	/** Constructor */
+	UShooterAimTargetComponent();
+
+	//~Begin UActorComponent interface
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~End UActorComponent interface
+
+	/**
+	 *  Returns the aim point on the owner's current aim ray
+	 *  @param bExact If true, runs a synchronous trace instead of reading the cache
+	 */
+	UFUNCTION(BlueprintCallable, Category="Aim")
+	FVector GetAimTargetLocation(bool bExact = false);
+
+	/** Returns the distance to the cached aim point along the aim ray */
+	UFUNCTION(BlueprintPure, Category="Aim")
+	float GetAimDistance() const { return AimDistance; }
+
+	/** Returns the last resolved aim trace */
+	const FHitResult& GetAimResult() const { return AimResult; }
+
+	/** Returns how long ago the cached result was traced, or a negative value if nothing has resolved yet */
+	UFUNCTION(BlueprintPure, Category="Aim")
+	float GetAimResultAge() const;
+
+	/** Runs a synchronous aim trace right away and stores it in the cache */
+	void ResolveAimNow();
+
+protected:
+
+	/** Returns the owner's aim ray. False if the owner can't aim */
+	bool GetAimRay(FVector& OutStart, FVector& OutEnd) const;
+
+	/** Stores a resolved aim trace */
+	void StoreAimResult(const FHitResult& Hit, const FVector& Start, const FVector& End);
+
+	/** Called when the async aim trace completes */
+	void OnAimTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum);
+};
@@ -7,6 +7,11 @@
 #include "Components/StaticMeshComponent.h"
 #include "ShooterWeaponHolder.h"
 #include "ShooterWeapon.h"
+#include "ShooterWeaponPreloader.h"
+#include "ProximityTriggerSubsystem.h"
+#include "ShooterPickupRegistry.h"
+#include "TeamGameState.h"
+#include "GameFramework/Pawn.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
 
@@ -21,16 +26,14 @@ AShooterPickup::AShooterPickup()
 	SphereCollision = CreateDefaultSubobject<USphereComponent>(TEXT("Sphere Collision"));
 	SphereCollision->SetupAttachment(RootComponent);
 
+	// the sphere only sizes the pickup trigger and fills the navmesh. Pawns are detected by the proximity trigger subsystem
 	SphereCollision->SetRelativeLocation(FVector(0.0f, 0.0f, 84.0f));
 	SphereCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
 	SphereCollision->SetCollisionObjectType(ECC_WorldStatic);
 	SphereCollision->SetCollisionResponseToAllChannels(ECR_Ignore);
-	SphereCollision->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	SphereCollision->SetGenerateOverlapEvents(false);
 	SphereCollision->bFillCollisionUnderneathForNavmesh = true;
 
-	// subscribe to the collision overlap on the sphere
-	SphereCollision->OnComponentBeginOverlap.AddDynamic(this, &AShooterPickup::OnOverlap);
-
 	// create the mesh
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
 	Mesh->SetupAttachment(SphereCollision);
@@ -44,8 +47,15 @@ void AShooterPickup::OnConstruction(const FTransform& Transform)
 
 	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
 	{
-		// set the mesh
-		Mesh->SetStaticMesh(WeaponData->StaticMesh.LoadSynchronous());
+		// the editor preview may load the mesh right away. Game worlds wait for the preloader instead
+		const UWorld* World = GetWorld();
+		const bool bGameWorld = World && World->IsGameWorld();
+
+		if (UStaticMesh* PickupMesh = bGameWorld ? WeaponData->StaticMesh.Get() : WeaponData->StaticMesh.LoadSynchronous())
+		{
+			// set the mesh
+			Mesh->SetStaticMesh(PickupMesh);
+		}
 	}
 }
 
@@ -53,10 +63,42 @@ void AShooterPickup::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
+	// find our slot in the game state's availability bitfield
+	if (UShooterPickupRegistry* PickupRegistry = GetWorld()->GetSubsystem<UShooterPickupRegistry>())
+	{
+		PickupIndex = PickupRegistry->GetPickupIndex(this);
+	}
+
+	// only the server hands out weapons. Clients follow the replicated availability
+	UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>();
+
+	if (HasAuthority() && ProximityTriggers)
 	{
-		// copy the weapon class
-		WeaponClass = WeaponData->WeaponToSpawn;
+		FProximityTriggerParams TriggerParams;
+		TriggerParams.Offset = SphereCollision->GetComponentLocation() - GetActorLocation();
+		TriggerParams.Radius = SphereCollision->GetScaledSphereRadius();
+		TriggerParams.bAliveOnly = true;
+		TriggerParams.OnEnter.BindUObject(this, &AShooterPickup::OnPawnEntered);
+
+		ProximityTrigger = ProximityTriggers->RegisterTrigger(this, TriggerParams);
+	}
+
+	const FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString());
+	UShooterWeaponPreloader* Preloader = GetWorld()->GetSubsystem<UShooterWeaponPreloader>();
+
+	if (WeaponData && Preloader)
+	{
+		// stay inactive until the weapon assets are resident
+		SetPickupEnabled(false);
+
+		WeaponAssetsHandle = Preloader->RequestWeaponAssets(*WeaponData, FStreamableDelegate::CreateUObject(this, &AShooterPickup::OnWeaponAssetsLoaded));
+	}
+
+	// late joiners start with the pickups that are already taken hidden
+	if (IsConsumed())
+	{
+		SetActorHiddenInGame(true);
+		SetPickupEnabled(false);
 	}
 }
 
@@ -66,31 +108,57 @@ void AShooterPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 	// clear the respawn timer
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+
+	// remove the pickup trigger
+	if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+	{
+		ProximityTriggers->UnregisterTrigger(ProximityTrigger);
+	}
+
+	ProximityTrigger = INDEX_NONE;
+
+	// stop waiting on the weapon assets
+	if (WeaponAssetsHandle)
+	{
+		WeaponAssetsHandle->CancelHandle();
+		WeaponAssetsHandle.Reset();
+	}
 }
 
-void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AShooterPickup::OnPawnEntered(APawn* Pawn)
 {
-	// have we collided against a weapon holder?
-	if (IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(OtherActor))
+	// has a weapon holder walked in?
+	IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(Pawn);
+
+	if (WeaponHolder && WeaponClass)
 	{
 		WeaponHolder->AddWeaponClass(WeaponClass);
 
 		// hide this mesh
 		SetActorHiddenInGame(true);
 
-		// disable collision
-		SetActorEnableCollision(false);
-
-		// disable ticking
-		SetActorTickEnabled(false);
+		// disable the trigger and ticking
+		SetPickupEnabled(false);
 
 		// schedule the respawn
 		GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
+
+		// let clients know through the game state
+		if (ATeamGameState* TeamGameState = GetWorld()->GetGameState<ATeamGameState>())
+		{
+			TeamGameState->SetPickupConsumed(PickupIndex, true);
+		}
 	}
 }
 
 void AShooterPickup::RespawnPickup()
 {
+	// let clients know through the game state
+	if (ATeamGameState* TeamGameState = GetWorld()->GetGameState<ATeamGameState>())
+	{
+		TeamGameState->SetPickupConsumed(PickupIndex, false);
+	}
+
 	// unhide this pickup
 	SetActorHiddenInGame(false);
 
@@ -98,11 +166,63 @@ void AShooterPickup::RespawnPickup()
 	BP_OnRespawn();
 }
 
+void AShooterPickup::OnAvailabilityReplicated(bool bAvailable)
+{
+	if (bAvailable)
+	{
+		// play the same respawn as the server
+		SetActorHiddenInGame(false);
+		BP_OnRespawn();
+
+	} else {
+
+		// someone took it
+		SetActorHiddenInGame(true);
+		SetPickupEnabled(false);
+	}
+}
+
+bool AShooterPickup::IsConsumed() const
+{
+	// clients only know what the game state tells them
+	const ATeamGameState* TeamGameState = GetWorld()->GetGameState<ATeamGameState>();
+
+	if (TeamGameState && TeamGameState->IsPickupConsumed(PickupIndex))
+	{
+		return true;
+	}
+
+	return GetWorld()->GetTimerManager().IsTimerActive(RespawnTimer);
+}
+
 void AShooterPickup::FinishRespawn()
 {
-	// enable collision
-	SetActorEnableCollision(true);
+	// enable the trigger and ticking
+	SetPickupEnabled(true);
+}
+
+void AShooterPickup::SetPickupEnabled(bool bEnabled)
+{
+	if (UProximityTriggerSubsystem* ProximityTriggers = GetWorld()->GetSubsystem<UProximityTriggerSubsystem>())
+	{
+		ProximityTriggers->SetTriggerEnabled(ProximityTrigger, bEnabled);
+	}
+
+	SetActorTickEnabled(bEnabled);
+}
+
+void AShooterPickup::OnWeaponAssetsLoaded()
+{
+	if (const FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
+	{
+		// set the mesh and copy the weapon class. Both are resident now
+		Mesh->SetStaticMesh(WeaponData->StaticMesh.Get());
+		WeaponClass = WeaponData->WeaponToSpawn.Get();
+	}
 
-	// enable tick
-	SetActorTickEnabled(true);
+	// activate the pickup, unless it's already waiting to respawn
+	if (!IsConsumed())
+	{
+		FinishRespawn();
+	}
 }
@@ -6,10 +6,11 @@
 #include "GameFramework/Actor.h"
 #include "Engine/DataTable.h"
 #include "Engine/StaticMesh.h"
+#include "Engine/StreamableManager.h"
 #include "ShooterPickup.generated.h"
 
 class USphereComponent;
-class UPrimitiveComponent;
+class APawn;
 class AShooterWeapon;
 
 /**
@@ -24,20 +25,22 @@ struct FWeaponTableRow : public FTableRowBase
 	UPROPERTY(EditAnywhere)
 	TSoftObjectPtr<UStaticMesh> StaticMesh;
 
-	/** Weapon class to grant on pickup */
+	/** Weapon class to grant on pickup. Streamed in by the weapon preloader */
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShooterWeapon> WeaponToSpawn;
+	TSoftClassPtr<AShooterWeapon> WeaponToSpawn;
 };
 
 /**
  *  Simple shooter game weapon pickup
+ *  The actor doesn't replicate. The server decides when it's taken and respawns, and clients follow the
+ *  availability bitfield replicated by the team game state.
  */
 UCLASS(abstract)
 class FIRSTPERSON_API AShooterPickup : public AActor
 {
 	GENERATED_BODY()
 
-	/** Collision sphere */
+	/** Sizes the pickup trigger and fills the navmesh underneath. Doesn't generate overlaps */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	USphereComponent* SphereCollision;
 
@@ -61,6 +64,15 @@ protected:
 	/** Timer to respawn the pickup */
 	FTimerHandle RespawnTimer;
 
+	/** Keeps this pickup's weapon assets streaming, then resident */
+	TSharedPtr<FStreamableHandle> WeaponAssetsHandle;
+
+	/** Handle of the proximity trigger that detects pawns walking in. Server only */
+	int32 ProximityTrigger = INDEX_NONE;
+
+	/** Index of this pickup in the game state's availability bitfield */
+	int32 PickupIndex = INDEX_NONE;
+
 public:	
 	
 	/** Constructor */
@@ -77,9 +89,8 @@ protected:
 	/** Gameplay cleanup */
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	/** Handles collision overlap */
-	UFUNCTION()
-	virtual void OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	/** Handles a player pawn walking into the pickup */
+	virtual void OnPawnEntered(APawn* Pawn);
 
 protected:
 
@@ -93,4 +104,23 @@ protected:
 	/** Enables this pickup after respawning */
 	UFUNCTION(BlueprintCallable, Category="Pickup")
 	void FinishRespawn();
+
+	/** Sets up the mesh and weapon class and enables the pickup once its weapon assets are resident */
+	void OnWeaponAssetsLoaded();
+
+	/** Turns the pickup trigger and ticking on or off */
+	void SetPickupEnabled(bool bEnabled);
+
+	/** Returns true while this pickup is consumed and waiting to respawn */
+	bool IsConsumed() const;
+
+public:
+
+	/** Called on clients when the game state replicates a change in this pickup's availability */
+	void OnAvailabilityReplicated(bool bAvailable);
+
+public:
+
+	/** Returns the data table this pickup reads its weapon from */
+	const UDataTable* GetWeaponTable() const { return WeaponType.DataTable; }
 };
@@ -0,0 +1,152 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterPickupRegistry.h"
+#include "ShooterPickup.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/LevelStreaming.h"
+
+void UShooterPickupRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UShooterPickupRegistry::OnLevelRemovedFromWorld);
+}
+
+void UShooterPickupRegistry::Deinitialize()
+{
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Super::Deinitialize();
+}
+
+int32 UShooterPickupRegistry::GetPickupIndex(const AShooterPickup* Pickup)
+{
+	// spawned pickups have no counterpart on the other side
+	if (!Pickup || !Pickup->IsNetStartupActor())
+	{
+		return INDEX_NONE;
+	}
+
+	IndexLevel(Pickup->GetLevel());
+
+	const int32* Index = PickupIndices.Find(Pickup);
+	return Index ? *Index : INDEX_NONE;
+}
+
+AShooterPickup* UShooterPickupRegistry::GetPickup(int32 Index) const
+{
+	const TWeakObjectPtr<AShooterPickup>* Pickup = Pickups.Find(Index);
+	return Pickup ? Pickup->Get() : nullptr;
+}
+
+void UShooterPickupRegistry::NotifyPickupAvailabilityChanged(int32 Index, bool bAvailable)
+{
+	// pickups in sublevels we haven't loaded pick the state up from the game state once they begin play
+	if (AShooterPickup* Pickup = GetPickup(Index))
+	{
+		Pickup->OnAvailabilityReplicated(bAvailable);
+	}
+}
+
+void UShooterPickupRegistry::IndexLevel(ULevel* Level)
+{
+	// a level is fully loaded before the first of its pickups asks, so its set of pickups is the same everywhere
+	if (!Level || IndexedLevels.Contains(Level))
+	{
+		return;
+	}
+
+	const int32 LevelSlot = GetLevelSlot(Level);
+
+	if (LevelSlot == INDEX_NONE)
+	{
+		return;
+	}
+
+	IndexedLevels.Add(Level);
+
+	TArray<AShooterPickup*> LevelPickups;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		AShooterPickup* Pickup = Cast<AShooterPickup>(Actor);
+
+		if (Pickup && Pickup->IsNetStartupActor())
+		{
+			LevelPickups.Add(Pickup);
+		}
+	}
+
+	// path names match between the server and clients
+	LevelPickups.Sort([](const AShooterPickup& A, const AShooterPickup& B)
+	{
+		return A.GetPathName() < B.GetPathName();
+	});
+
+	if (LevelPickups.Num() > MaxPickupsPerLevel)
+	{
+		UE_LOG(LogFirstPerson, Warning, TEXT("%s has %d weapon pickups. Only the first %d replicate their availability"), *GetNameSafe(Level->GetOuter()), LevelPickups.Num(), MaxPickupsPerLevel);
+		LevelPickups.SetNum(MaxPickupsPerLevel);
+	}
+
+	for (int32 LocalIndex = 0; LocalIndex < LevelPickups.Num(); ++LocalIndex)
+	{
+		const int32 Index = LevelSlot * MaxPickupsPerLevel + LocalIndex;
+
+		Pickups.Add(Index, LevelPickups[LocalIndex]);
+		PickupIndices.Add(LevelPickups[LocalIndex], Index);
+	}
+}
+
+void UShooterPickupRegistry::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+	// a null level means every level is going away
+	if (World != GetWorld() || (Level && !IndexedLevels.Contains(Level)))
+	{
+		return;
+	}
+
+	for (auto It = PickupIndices.CreateIterator(); It; ++It)
+	{
+		const AShooterPickup* Pickup = It.Key().ResolveObjectPtr();
+
+		if (!Level || !Pickup || Pickup->GetLevel() == Level)
+		{
+			Pickups.Remove(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+
+	if (Level)
+	{
+		IndexedLevels.Remove(Level);
+
+	} else {
+
+		IndexedLevels.Reset();
+	}
+}
+
+int32 UShooterPickupRegistry::GetLevelSlot(const ULevel* Level) const
+{
+	if (Level->IsPersistentLevel())
+	{
+		return 0;
+	}
+
+	// the streaming level list comes from the persistent level, so its order is the same everywhere
+	const TArray<ULevelStreaming*>& StreamingLevels = GetWorld()->GetStreamingLevels();
+
+	for (int32 StreamingIndex = 0; StreamingIndex < StreamingLevels.Num(); ++StreamingIndex)
+	{
+		if (StreamingLevels[StreamingIndex] && StreamingLevels[StreamingIndex]->GetLoadedLevel() == Level)
+		{
+			return StreamingIndex + 1;
+		}
+	}
+
+	return INDEX_NONE;
+}
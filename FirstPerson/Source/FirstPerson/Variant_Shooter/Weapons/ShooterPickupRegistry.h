@@ -0,0 +1,66 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterPickupRegistry.generated.h"
+
+class AShooterPickup;
+class ULevel;
+
+/**
+ *  Gives every level placed weapon pickup a stable index
+ *  Each level owns a fixed block of indices: the persistent level the first one, and every streaming level the block
+ *  matching its place in the world's streaming level list. Inside a block, pickups are sorted by path name.
+ *  The server and every client agree on the indices without replicating the pickup actors, whichever sublevels
+ *  they happen to have loaded. The game state replicates pickup availability as a bitfield over these indices,
+ *  and the registry routes each change back to its pickup.
+ */
+UCLASS()
+class FIRSTPERSON_API UShooterPickupRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Pickups by index */
+	TMap<int32, TWeakObjectPtr<AShooterPickup>> Pickups;
+
+	/** Index of each pickup */
+	TMap<TObjectKey<AShooterPickup>, int32> PickupIndices;
+
+	/** Loaded levels whose pickups have been indexed */
+	TSet<TObjectKey<ULevel>> IndexedLevels;
+
+	/** Handle of the level removal callback */
+	FDelegateHandle LevelRemovedHandle;
+
+public:
+
+	/** Pickups each level can index. Pickups past this in a single level aren't tracked by the game state */
+	static constexpr int32 MaxPickupsPerLevel = 32;
+
+	//~Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~End USubsystem interface
+
+	/** Returns the index of a pickup, or INDEX_NONE if it wasn't placed in a level */
+	int32 GetPickupIndex(const AShooterPickup* Pickup);
+
+	/** Returns the pickup at an index, if its level is loaded */
+	AShooterPickup* GetPickup(int32 Index) const;
+
+	/** Called on clients when the replicated availability of a pickup changes */
+	void NotifyPickupAvailabilityChanged(int32 Index, bool bAvailable);
+
+protected:
+
+	/** Indexes every pickup placed in a level, the first time one of them asks */
+	void IndexLevel(ULevel* Level);
+
+	/** Forgets a streamed out level's pickups, so they're indexed again if it streams back in */
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+
+	/** Returns the block of indices a level owns, or INDEX_NONE if it isn't part of this world */
+	int32 GetLevelSlot(const ULevel* Level) const;
+};
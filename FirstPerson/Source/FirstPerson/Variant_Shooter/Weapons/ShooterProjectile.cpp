@@ -9,9 +9,16 @@
 #include "GameFramework/DamageType.h"
 #include "GameFramework/Pawn.h"
 #include "GameFramework/Controller.h"
-#include "Engine/OverlapResult.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileBatchSubsystem.h"
+#include "ProjectileBallistics.h"
+#include "ImpactEffectSubsystem.h"
+#include "ExplosionSubsystem.h"
+#include "NoiseAggregatorSubsystem.h"
+#include "NetUpdateRateSubsystem.h"
+#include "Net/UnrealNetwork.h"
 
 AShooterProjectile::AShooterProjectile()
 {
@@ -34,16 +41,53 @@ AShooterProjectile::AShooterProjectile()
 	ProjectileMovement->MaxSpeed = 3000.0f;
 	ProjectileMovement->bShouldBounce = true;
 
+	// sub-step so trajectories don't depend on the frame rate
+	ProjectileMovement->bForceSubStepping = true;
+	ProjectileMovement->MaxSimulationTimeStep = FProjectileBallistics::FixedStep;
+	ProjectileMovement->MaxSimulationIterations = FProjectileBallistics::MaxStepsPerFrame;
+
 	// set the default damage type
 	HitDamageType = UDamageType::StaticClass();
 }
 
+void AShooterProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterProjectile, PoolLaunch);
+}
+
+float AShooterProjectile::GetLaunchSpeed() const
+{
+	return ProjectileMovement->InitialSpeed;
+}
+
+void AShooterProjectile::GetBatchedProjectileParams(FBatchedProjectileParams& OutParams) const
+{
+	OutParams.Speed = ProjectileMovement->InitialSpeed;
+	OutParams.Radius = CollisionComponent->GetScaledSphereRadius();
+	OutParams.GravityScale = ProjectileMovement->ProjectileGravityScale;
+	OutParams.Restitution = ProjectileMovement->Bounciness;
+	OutParams.Friction = ProjectileMovement->Friction;
+	OutParams.Damage = HitDamage;
+	OutParams.PhysicsForce = PhysicsForce;
+	OutParams.DamageType = HitDamageType;
+
+	OutParams.MaxLifetime = MaxFlightTime;
+}
+
 void AShooterProjectile::BeginPlay()
 {
 	Super::BeginPlay();
 	
 	// ignore the pawn that shot this projectile
 	CollisionComponent->IgnoreActorWhenMoving(GetInstigator(), true);
+
+	// adapt the update rate to the projectile's flight and distance from players
+	if (UNetUpdateRateSubsystem* NetUpdateRate = HasAuthority() ? GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>() : nullptr)
+	{
+		NetUpdateRate->RegisterActor(this);
+	}
 }
 
 void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -52,6 +96,16 @@ void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
 
 	// clear the destruction timer
 	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+
+	if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+	{
+		NetUpdateRate->UnregisterActor(this);
+	}
+}
+
+float AShooterProjectile::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	return UNetUpdateRateSubsystem::ScaleNetPriority(this, ViewPos, Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth));
 }
 
 void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
@@ -67,8 +121,15 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 	// disable collision on the projectile
 	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
-	// make AI perception noise
-	MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
+	// make AI perception noise. Nearby impacts from the same shooter merge into one stimulus
+	if (UNoiseAggregatorSubsystem* NoiseAggregator = GetWorld()->GetSubsystem<UNoiseAggregatorSubsystem>())
+	{
+		NoiseAggregator->ReportNoise(this, GetInstigator(), GetActorLocation(), NoiseLoudness, NoiseRange, NoiseTag);
+
+	} else {
+
+		MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
+	}
 
 	if (bExplodeOnHit)
 	{
@@ -83,8 +144,13 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 
 	}
 
-	// pass control to BP for any extra effects
-	BP_OnProjectileHit(Hit);
+	// spawn the impact effect and pass control to BP for any extra effects. Dedicated servers have nobody to show them to
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		UImpactEffectSubsystem::QueueImpact(this, ImpactEffect, Hit.ImpactPoint, Hit.ImpactNormal.Rotation());
+
+		BP_OnProjectileHit(Hit);
+	}
 
 	// check if we should schedule deferred destruction of the projectile
 	if (DeferredDestructionTime > 0.0f)
@@ -93,58 +159,35 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 
 	} else {
 
-		// destroy the projectile right away
-		Destroy();
+		// return the projectile right away
+		UProjectilePoolSubsystem::ReleaseOrDestroy(this);
 	}
 }
 
 void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 {
-	// do a sphere overlap check look for nearby actors to damage
-	TArray<FOverlapResult> Overlaps;
-
-	FCollisionShape OverlapShape;
-	OverlapShape.SetSphere(ExplosionRadius);
-
-	FCollisionObjectQueryParams ObjectParams;
-	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
-	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
-	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
-
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
-	if (!bDamageOwner)
+	// hand the explosion to the explosion service, which resolves every explosion of the frame together
+	if (UExplosionSubsystem* Explosions = GetWorld()->GetSubsystem<UExplosionSubsystem>())
 	{
-		QueryParams.AddIgnoredActor(GetInstigator());
-	}
-
-	GetWorld()->OverlapMultiByObjectType(Overlaps, ExplosionCenter, FQuat::Identity, ObjectParams, OverlapShape, QueryParams);
-
-	TArray<AActor*> DamagedActors;
-
-	// process the overlap results
-	for (const FOverlapResult& CurrentOverlap : Overlaps)
-	{
-		// overlaps may return the same actor multiple times per each component overlapped
-		// ensure we only damage each actor once by adding it to a damaged list
-		if (DamagedActors.Find(CurrentOverlap.GetActor()) == INDEX_NONE)
-		{
-			DamagedActors.Add(CurrentOverlap.GetActor());
-
-			// apply physics force away from the explosion
-			const FVector& ExplosionDir = CurrentOverlap.GetActor()->GetActorLocation() - GetActorLocation();
-
-			// push and/or damage the overlapped actor
-			ProcessHit(CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), GetActorLocation(), ExplosionDir.GetSafeNormal());
-		}
-			
+		FExplosionRequest Request;
+		Request.Center = ExplosionCenter;
+		Request.Radius = ExplosionRadius;
+		Request.Damage = HitDamage;
+		Request.PhysicsForce = PhysicsForce;
+		Request.DamageType = HitDamageType;
+		Request.Instigator = GetInstigator();
+		Request.DamageCauser = this;
+		Request.bDamageInstigator = bDamageOwner;
+
+		Explosions->QueueExplosion(Request);
 	}
 }
 
 void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
 {
-	// have we hit a character?
-	if (ACharacter* HitCharacter = Cast<ACharacter>(HitActor))
+	// have we hit a character? Only the server applies damage, clients may be simulating a cosmetic copy
+	ACharacter* HitCharacter = Cast<ACharacter>(HitActor);
+	if (HitCharacter && GetNetMode() != NM_Client)
 	{
 		// ignore the owner of this projectile
 		if (HitCharacter != GetOwner() || bDamageOwner)
@@ -164,6 +207,86 @@ void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitCo
 
 void AShooterProjectile::OnDeferredDestruction()
 {
-	// destroy this actor
-	Destroy();
+	// return this actor to the pool
+	UProjectilePoolSubsystem::ReleaseOrDestroy(this);
+}
+
+void AShooterProjectile::OnRep_PoolLaunch()
+{
+	// move our copy to the new launch. Movement isn't replicated, so we simulate the flight locally
+	SetActorLocationAndRotation(PoolLaunch.Location, PoolLaunch.Direction.Rotation(), false, nullptr, ETeleportType::ResetPhysics);
+
+	// the projectile may be sitting in the pool when it first becomes relevant to us
+	if (IsHidden())
+	{
+		return;
+	}
+
+	ResetHitState();
+	RestartMovement();
+}
+
+void AShooterProjectile::ResetHitState()
+{
+	// accept hits again
+	bHit = false;
+
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+
+	// ignore the new shooter instead of the previous one
+	CollisionComponent->ClearMoveIgnoreActors();
+	CollisionComponent->IgnoreActorWhenMoving(GetInstigator(), true);
+}
+
+void AShooterProjectile::OnAcquiredFromPool()
+{
+	SetActorHiddenInGame(false);
+	SetActorTickEnabled(true);
+
+	// wake up replication so clients see the projectile again
+	SetNetDormancy(DORM_Awake);
+
+	ResetHitState();
+	RestartMovement();
+
+	// let clients relaunch their copy
+	PoolLaunch.Location = GetActorLocation();
+	PoolLaunch.Direction = GetActorForwardVector();
+	++PoolLaunch.Generation;
+
+	ForceNetUpdate();
+}
+
+void AShooterProjectile::RestartMovement()
+{
+	ProjectileMovement->SetUpdatedComponent(CollisionComponent);
+	ProjectileMovement->Velocity = GetActorForwardVector() * ProjectileMovement->InitialSpeed;
+	ProjectileMovement->UpdateComponentVelocity();
+	ProjectileMovement->SetComponentTickEnabled(true);
+}
+
+void AShooterProjectile::OnReturnedToPool()
+{
+	// a pending deferred destruction no longer applies
+	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+
+	// stop in place
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->SetComponentTickEnabled(false);
+
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
+
+	// stop replicating once the hidden state has been sent
+	SetNetDormancy(DORM_DormantAll);
+}
+
+FProjectileFlightLimits AShooterProjectile::GetFlightLimits() const
+{
+	FProjectileFlightLimits Limits;
+	Limits.MaxFlightTime = MaxFlightTime;
+	Limits.MaxFlightRange = MaxFlightRange;
+	return Limits;
 }
@@ -4,18 +4,21 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PooledProjectile.h"
 #include "ShooterProjectile.generated.h"
 
 class USphereComponent;
 class UProjectileMovementComponent;
 class ACharacter;
 class UPrimitiveComponent;
+class UParticleSystem;
+struct FBatchedProjectileParams;
 
 /**
  *  Simple projectile class for a first person shooter game
  */
 UCLASS(abstract)
-class FIRSTPERSON_API AShooterProjectile : public AActor
+class FIRSTPERSON_API AShooterProjectile : public AActor, public IPooledProjectile
 {
 	GENERATED_BODY()
 	
@@ -53,6 +56,10 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
 	TSubclassOf<UDamageType> HitDamageType;
 
+	/** Optional particle effect spawned at the impact point through the impact effects dispatcher */
+	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
+	UParticleSystem* ImpactEffect = nullptr;
+
 	/** If true, the projectile can damage the character that shot it */
 	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
 	bool bDamageOwner = false;
@@ -75,11 +82,38 @@ protected:
 	/** Timer to handle deferred destruction of this projectile */
 	FTimerHandle DestructionTimer;
 
+	/** Max time in flight before the lifetime manager takes the projectile back */
+	UPROPERTY(EditAnywhere, Category="Projectile|Destruction", meta = (ClampMin = 0, ClampMax = 60, Units = "s"))
+	float MaxFlightTime = 10.0f;
+
+	/** Max distance from the muzzle before the lifetime manager takes the projectile back */
+	UPROPERTY(EditAnywhere, Category="Projectile|Destruction", meta = (ClampMin = 0, ClampMax = 100000, Units = "cm"))
+	float MaxFlightRange = 20000.0f;
+
+	/** Updated every time the projectile is taken out of the pool, so clients can relaunch their copy */
+	UPROPERTY(ReplicatedUsing = OnRep_PoolLaunch)
+	FPooledProjectileLaunch PoolLaunch;
+
 public:	
 
 	/** Constructor */
 	AShooterProjectile();
 
+	/** Replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Fills the batch simulation parameters from this projectile's settings. Usually called on the class defaults */
+	void GetBatchedProjectileParams(FBatchedProjectileParams& OutParams) const;
+
+	/** Returns true if this projectile applies radial damage on hit */
+	bool ExplodesOnHit() const { return bExplodeOnHit; }
+
+	/** Returns the speed this projectile is launched at */
+	float GetLaunchSpeed() const;
+
+	/** Scales the net priority by activity and distance from the viewer */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
 protected:
 	
 	/** Gameplay initialization */
@@ -93,7 +127,7 @@ protected:
 
 protected:
 
-	/** Looks up actors within the explosion radius and damages them */
+	/** Queues an explosion with the explosion service, which damages and pushes the actors within the explosion radius */
 	void ExplosionCheck(const FVector& ExplosionCenter);
 
 	/** Processes a projectile hit for the given actor */
@@ -106,4 +140,28 @@ protected:
 	/** Called from the destruction timer to destroy this projectile */
 	void OnDeferredDestruction();
 
+	/** Relaunches the client copy of the projectile after the server reused it */
+	UFUNCTION()
+	void OnRep_PoolLaunch();
+
+	/** Re-enables collision and hit processing for a fresh shot */
+	void ResetHitState();
+
+	/** Restarts movement along the current facing */
+	void RestartMovement();
+
+public:
+
+	//~Begin IPooledProjectile interface
+
+	/** Restarts movement and collision after being taken out of the pool */
+	virtual void OnAcquiredFromPool() override;
+
+	/** Stops movement and hides the projectile when it's handed back to the pool */
+	virtual void OnReturnedToPool() override;
+
+	/** Returns the max flight time and range */
+	virtual FProjectileFlightLimits GetFlightLimits() const override;
+
+	//~End IPooledProjectile interface
 };
@@ -2,6 +2,7 @@
 
 
 #include "ShooterWeapon.h"
+#include "ShooterWeaponFirePolicies.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterProjectile.h"
@@ -11,10 +12,32 @@
 #include "Animation/AnimInstance.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/Pawn.h"
+#include "ProjectilePoolSubsystem.h"
+#include "LagCompensationSubsystem.h"
+#include "ProjectileBatchSubsystem.h"
+#include "ProjectileFireEventComponent.h"
+#include "NoiseAggregatorSubsystem.h"
+#include "NetUpdateRateSubsystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "FirstPerson.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Ammo Corrections"), STAT_WeaponAmmoCorrections, STATGROUP_FirstPerson);
 
 AShooterWeapon::AShooterWeapon()
 {
+	// replicate to the owner's connection for ammo, and to everyone else for cosmetics
+	bReplicates = true;
+	bNetUseOwnerRelevancy = true;
+
+	// the weapon only ticks to schedule full auto shots
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -34,6 +57,9 @@ AShooterWeapon::AShooterWeapon()
 	ThirdPersonMesh->SetCollisionProfileName(FName("NoCollision"));
 	ThirdPersonMesh->SetFirstPersonPrimitiveType(EFirstPersonPrimitiveType::WorldSpaceRepresentation);
 	ThirdPersonMesh->bOwnerNoSee = true;
+
+	// set the default hitscan damage type
+	HitscanDamageType = UDamageType::StaticClass();
 }
 
 void AShooterWeapon::BeginPlay()
@@ -50,8 +76,27 @@ void AShooterWeapon::BeginPlay()
 	// fill the first ammo clip
 	CurrentBullets = MagazineSize;
 
+	SelectFirePolicy();
+
 	// attach the meshes to the owner
 	WeaponOwner->AttachWeaponMeshes(this);
+
+	if (HasAuthority())
+	{
+		// we start out as our own class
+		EquippedClass = GetClass();
+		UpdateWeaponState();
+
+	} else if (EquippedClass) {
+
+		// the server may have switched classes before we were replicated
+		OnRep_EquippedClass();
+	}
+
+	// schedule shots after the owner has moved, so the muzzle is up to date
+	AddTickPrerequisiteActor(GetOwner());
+
+	PrewarmProjectilePool();
 }
 
 void AShooterWeapon::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -62,6 +107,149 @@ void AShooterWeapon::EndPlay(EEndPlayReason::Type EndPlayReason)
 	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
 }
 
+void AShooterWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// the scheduler only runs while the trigger wants more shots
+	if (!bIsFiring)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const FVector MuzzleLocation = GetMuzzleLocation();
+	const FVector TargetLocation = WeaponOwner->GetWeaponTargetLocation();
+	const float ScheduleSpan = Now - LastScheduleTime;
+
+	// fire every shot that came due since the last update, at its own time
+	// shots past the per frame cap stay scheduled and fire over the next frames, aged to their own time
+	int32 NumShots = 0;
+
+	while (bIsFiring && NextShotTime <= Now && NumShots < MaxShotsPerFrame)
+	{
+		// place the shot between last update's muzzle and aim and this one's
+		const float Alpha = ScheduleSpan > 0.0f ? FMath::Clamp((NextShotTime - LastScheduleTime) / ScheduleSpan, 0.0f, 1.0f) : 1.0f;
+
+		const bool bKeepFiring = FireShot(FMath::Lerp(LastScheduleMuzzle, MuzzleLocation, Alpha), FMath::Lerp(LastScheduleTarget, TargetLocation, Alpha), NextShotTime);
+
+		NextShotTime += RefireRate;
+		++NumShots;
+
+		// the burst is done
+		if (!bKeepFiring)
+		{
+			SetActorTickEnabled(false);
+			return;
+		}
+	}
+
+	LastScheduleTime = Now;
+	LastScheduleMuzzle = MuzzleLocation;
+	LastScheduleTarget = TargetLocation;
+}
+
+void AShooterWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// only the owner displays the ammo count
+	DOREPLIFETIME_CONDITION(AShooterWeapon, WeaponState, COND_OwnerOnly);
+
+	// the owner already played its own shots
+	DOREPLIFETIME_CONDITION(AShooterWeapon, FireCounter, COND_SkipOwner);
+
+	DOREPLIFETIME(AShooterWeapon, EquippedClass);
+}
+
+void AShooterWeapon::ServerStartFiring_Implementation()
+{
+	StartFiring();
+}
+
+void AShooterWeapon::ServerStopFiring_Implementation()
+{
+	StopFiring();
+}
+
+void AShooterWeapon::OnRep_WeaponState()
+{
+	// nothing is in flight while we're not firing, so the server's count is the whole story
+	if (!bIsFiring)
+	{
+		PredictedShotSequence = WeaponState.ShotSequence;
+	}
+
+	// predicted shots the server hasn't accounted for yet. A server that's ahead of us wraps around to a large count
+	uint8 PendingShots = PredictedShotSequence - WeaponState.ShotSequence;
+
+	if (PendingShots > MAX_int8)
+	{
+		PredictedShotSequence = WeaponState.ShotSequence;
+		PendingShots = 0;
+	}
+
+	// once the server has caught up with our shots, its last shot time sets the refire cooldown
+	if (PendingShots == 0)
+	{
+		ApplyServerShotTime();
+	}
+
+	// replay the pending shots on top of the server's ammo
+	const int32 PredictedBullets = CurrentBullets;
+	CurrentBullets = WeaponState.Bullets;
+
+	for (uint8 Shot = 0; Shot < PendingShots; ++Shot)
+	{
+		ConsumeBullet();
+	}
+
+	if (CurrentBullets != PredictedBullets)
+	{
+		INC_DWORD_STAT(STAT_WeaponAmmoCorrections);
+	}
+
+	// update the weapon HUD
+	if (WeaponOwner)
+	{
+		WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+	}
+}
+
+void AShooterWeapon::OnRep_FireCounter()
+{
+	// several shots may arrive in a single update. Cosmetics only need to play once
+	if (WeaponOwner)
+	{
+		WeaponOwner->PlayFiringMontage(FiringMontage);
+	}
+
+	BP_OnSimulatedShot();
+}
+
+void AShooterWeapon::OnRep_EquippedClass()
+{
+	// this may arrive before BeginPlay, which catches up on it
+	if (!WeaponOwner || !EquippedClass)
+	{
+		return;
+	}
+
+	ApplyWeaponClassDefaults(EquippedClass);
+
+	// take on the slot's ammo and cooldown. They may match the previous weapon's, in which case the weapon state doesn't replicate again
+	PredictedShotSequence = WeaponState.ShotSequence;
+	CurrentBullets = WeaponState.Bullets;
+	ApplyServerShotTime();
+
+	// refresh the owner's anim classes and HUD
+	if (!IsHidden())
+	{
+		WeaponOwner->OnWeaponActivated(this);
+	}
+}
+
 void AShooterWeapon::OnOwnerDestroyed(AActor* DestroyedActor)
 {
 	// ensure this weapon is destroyed when the owner is destroyed
@@ -91,65 +279,139 @@ void AShooterWeapon::DeactivateWeapon()
 
 void AShooterWeapon::StartFiring()
 {
-	// raise the firing flag
+	// the server fires the real shots. Owning clients only predict ammo and cosmetics
+	if (!HasAuthority())
+	{
+		ServerStartFiring();
+	}
+
+	// raise the firing flag and start a new trigger pull
 	bIsFiring = true;
+	ShotsThisTrigger = 0;
+
+	// start interpolating shots from the current muzzle and aim
+	LastScheduleTime = GetWorld()->GetTimeSeconds();
+	LastScheduleMuzzle = GetMuzzleLocation();
+	LastScheduleTarget = WeaponOwner->GetWeaponTargetLocation();
 
 	// check how much time has passed since we last shot
 	// this may be under the refire rate if the weapon shoots slow enough and the player is spamming the trigger
-	const float TimeSinceLastShot = GetWorld()->GetTimeSeconds() - TimeOfLastShot;
+	const float TimeSinceLastShot = LastScheduleTime - TimeOfLastShot;
+
+	// full auto and burst weapons keep firing from the scheduler
+	bool bKeepFiring = bFullAuto;
 
 	if (TimeSinceLastShot > RefireRate)
 	{
 		// fire the weapon right away
-		Fire();
+		bKeepFiring = FireShot(LastScheduleMuzzle, LastScheduleTarget, LastScheduleTime);
+		NextShotTime = LastScheduleTime + RefireRate;
 
 	} else {
 
-		// if we're full auto, schedule the next shot
-		if (bFullAuto)
-		{
-			GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, TimeSinceLastShot, false);
-		}
-
+		// the next shot is due once the refire rate has passed
+		NextShotTime = TimeOfLastShot + RefireRate;
 	}
+
+	SetActorTickEnabled(bKeepFiring);
 }
 
 void AShooterWeapon::StopFiring()
 {
+	if (!HasAuthority() && bIsFiring)
+	{
+		ServerStopFiring();
+	}
+
 	// lower the firing flag
 	bIsFiring = false;
 
-	// clear the refire timer
+	// clear the refire timer and stop the scheduler
 	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
+	SetActorTickEnabled(false);
 }
 
-void AShooterWeapon::Fire()
+void AShooterWeapon::LoadWeaponSlot(const FShooterWeaponSlot& Slot)
 {
-	// ensure the player still wants to fire. They may have let go of the trigger
-	if (!bIsFiring)
+	// swap meshes and parameters only when the class actually changes
+	if (Slot.WeaponClass && Slot.WeaponClass != EquippedClass)
 	{
-		return;
+		ApplyWeaponClassDefaults(Slot.WeaponClass);
 	}
-	
-	// fire a projectile at the target
-	FireProjectile(WeaponOwner->GetWeaponTargetLocation());
 
-	// update the time of our last shot
-	TimeOfLastShot = GetWorld()->GetTimeSeconds();
+	// restore the slot state
+	CurrentBullets = Slot.Bullets;
+	TimeOfLastShot = Slot.TimeOfLastShot;
+
+	UpdateWeaponState();
+}
 
-	// make noise so the AI perception system can hear us
-	MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+void AShooterWeapon::SaveWeaponSlot(FShooterWeaponSlot& Slot) const
+{
+	Slot.Bullets = CurrentBullets;
+	Slot.TimeOfLastShot = TimeOfLastShot;
+}
 
-	// are we full auto?
-	if (bFullAuto)
+void AShooterWeapon::SelectFirePolicy()
+{
+	FireShotFunction = SelectShooterFirePolicy(bFullAuto, BurstCount, FireMode, bInfiniteAmmo);
+}
+
+float AShooterWeapon::GetShotAge(float ShotTime) const
+{
+	return FMath::Max(0.0f, GetWorld()->GetTimeSeconds() - ShotTime);
+}
+
+void AShooterWeapon::RecordShot(float ShotTime)
+{
+	if (HasAuthority())
 	{
-		// schedule the next shot
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, RefireRate, false);
+		// make noise so the AI perception system can hear us. Rapid shots merge into one stimulus
+		if (UNoiseAggregatorSubsystem* NoiseAggregator = GetWorld()->GetSubsystem<UNoiseAggregatorSubsystem>())
+		{
+			NoiseAggregator->ReportNoise(this, PawnOwner, PawnOwner->GetActorLocation(), ShotLoudness, ShotNoiseRange, ShotNoiseTag);
+
+		} else {
+
+			MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+		}
+
+		// firing pawns replicate at their full rate
+		if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+		{
+			NetUpdateRate->NotifyActivity(PawnOwner);
+		}
+
+		// let the other clients play the shot's cosmetics
+		++FireCounter;
+		++WeaponState.ShotSequence;
+
 	} else {
 
-		// for semi-auto weapons, schedule the cooldown notification
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::FireCooldownExpired, RefireRate, false);
+		++PredictedShotSequence;
+	}
 
+	// update the time of our last shot
+	TimeOfLastShot = ShotTime;
+
+	// play the firing montage
+	WeaponOwner->PlayFiringMontage(FiringMontage);
+
+	// add recoil
+	WeaponOwner->AddWeaponRecoil(FiringRecoil);
+}
+
+void AShooterWeapon::FinishShot(bool bKeepFiring)
+{
+	UpdateWeaponState();
+
+	// update the weapon HUD
+	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+
+	// once a semi-auto or burst trigger pull is done, schedule the cooldown notification
+	if (!bKeepFiring)
+	{
+		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::FireCooldownExpired, RefireRate, false);
 	}
 }
 
@@ -159,46 +421,313 @@ void AShooterWeapon::FireCooldownExpired()
 	WeaponOwner->OnSemiWeaponRefire();
 }
 
-void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
+void AShooterWeapon::ConsumeBullet()
 {
-	// get the projectile transform
-	FTransform ProjectileTransform = CalculateProjectileSpawnTransform(TargetLocation);
+	if (!bInfiniteAmmo)
+	{
+		FShooterMagazineAmmo::Consume(CurrentBullets, MagazineSize);
+	}
+}
+
+void AShooterWeapon::UpdateWeaponState()
+{
+	if (HasAuthority())
+	{
+		WeaponState.Bullets = static_cast<uint8>(FMath::Clamp(CurrentBullets, 0, MAX_uint8));
+
+		// the server's world time is the server time clients sync against
+		WeaponState.TimeOfLastShot = TimeOfLastShot;
+	}
+}
+
+void AShooterWeapon::ApplyServerShotTime()
+{
+	// convert the server's shot time to our own world time
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		TimeOfLastShot = WeaponState.TimeOfLastShot - static_cast<float>(GameState->GetServerWorldTimeSeconds() - GetWorld()->GetTimeSeconds());
+	}
+}
+
+void AShooterWeapon::LaunchProjectile(const FTransform& InProjectileTransform, float ShotAge)
+{
+	// shooters opt into fire events by having the component
+	UProjectileFireEventComponent* FireEvents = GetOwner()->FindComponentByClass<UProjectileFireEventComponent>();
+
+	// start the projectile where it would be by now if it had been launched on time
+	const float LaunchSpeed = ProjectileClass ? ProjectileClass->GetDefaultObject<AShooterProjectile>()->GetLaunchSpeed() : 0.0f;
+	const FTransform ProjectileTransform = AdvanceLaunchTransform(InProjectileTransform, LaunchSpeed, ShotAge);
 	
-	// spawn the projectile
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
-	SpawnParams.Owner = GetOwner();
-	SpawnParams.Instigator = PawnOwner;
+	if (ShouldSimulateProjectilesInBatch())
+	{
+		// simulate the projectile without an actor
+		if (UProjectileBatchSubsystem* ProjectileBatch = GetWorld()->GetSubsystem<UProjectileBatchSubsystem>())
+		{
+			FBatchedProjectileParams Params;
+			ProjectileClass->GetDefaultObject<AShooterProjectile>()->GetBatchedProjectileParams(Params);
+			Params.ImpactActorClass = BatchedImpactActorClass;
 
-	AShooterProjectile* Projectile = GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
+			ProjectileBatch->LaunchProjectile(Params, ProjectileTransform, GetOwner());
 
-	// play the firing montage
-	WeaponOwner->PlayFiringMontage(FiringMontage);
+			// let remote clients play a cosmetic copy
+			if (FireEvents)
+			{
+				FireEvents->RecordFireEvent(ProjectileClass, ProjectileTransform);
+			}
+		}
 
-	// add recoil
-	WeaponOwner->AddWeaponRecoil(FiringRecoil);
+	} else if (FireEvents && FireEvents->FireProjectile(ProjectileClass, ProjectileTransform, PawnOwner))
+	{
+		// the shot was sent to clients as a fire event instead of a replicated projectile
+
+	} else if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		// take a projectile from the pool
+		ProjectilePool->AcquireProjectile<AShooterProjectile>(ProjectileClass, ProjectileTransform, GetOwner(), PawnOwner);
 
-	// consume bullets
-	--CurrentBullets;
+	} else {
 
-	// if the clip is depleted, reload it
-	if (CurrentBullets <= 0)
+		// spawn the projectile
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
+		SpawnParams.Owner = GetOwner();
+		SpawnParams.Instigator = PawnOwner;
+
+		GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
+	}
+}
+
+FTransform AShooterWeapon::AdvanceLaunchTransform(const FTransform& ProjectileTransform, float Speed, float ShotAge) const
+{
+	if (ShotAge <= 0.0f || Speed <= 0.0f)
 	{
-		CurrentBullets = MagazineSize;
+		return ProjectileTransform;
 	}
 
-	// update the weapon HUD
-	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+	const FVector Start = ProjectileTransform.GetLocation();
+	FVector End = Start + ProjectileTransform.GetRotation().GetForwardVector() * (Speed * ShotAge);
+
+	// don't tunnel through a wall the projectile would have hit on the way
+	FHitResult OutHit;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AdvanceLaunchTrace), false, GetOwner());
+
+	if (GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams))
+	{
+		End = OutHit.Location - (End - Start).GetSafeNormal();
+	}
+
+	FTransform AdvancedTransform = ProjectileTransform;
+	AdvancedTransform.SetLocation(End);
+
+	return AdvancedTransform;
+}
+
+void AShooterWeapon::FireHitscan(const FTransform& ShotTransform, float ShotAge)
+{
+	FLagCompensationRewind Rewind;
+	const bool bRewound = RewindForShot(ShotAge, Rewind);
+
+	TraceHitscan(ShotTransform, bRewound ? &Rewind : nullptr);
+}
+
+bool AShooterWeapon::RewindForShot(float ShotAge, FLagCompensationRewind& OutRewind) const
+{
+	// only the server resolves hits against the past
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
+	if (const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		// rewind the characters to what the shooter was seeing when it fired, including how late the shot was scheduled
+		LagCompensation->Rewind(LagCompensation->GetShooterViewTime(PawnOwner) - ShotAge, GetOwner(), OutRewind);
+		return true;
+	}
+
+	return false;
+}
+
+void AShooterWeapon::TraceHitscan(const FTransform& ShotTransform, const FLagCompensationRewind* Rewind)
+{
+	const FVector Start = ShotTransform.GetLocation();
+	const FVector ShotDir = ShotTransform.GetRotation().GetForwardVector();
+	const FVector End = Start + (ShotDir * HitscanRange);
+
+	FHitResult OutHit;
+
+	if (Rewind)
+	{
+		// trace against the characters as the shooter saw them
+		GetWorld()->GetSubsystem<ULagCompensationSubsystem>()->RewoundLineTrace(*Rewind, OutHit, Start, End);
+
+	} else {
+
+		// cosmetic trace against the current world state
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HitscanTrace), false, GetOwner());
+		GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
+	}
+
+	// only the server applies damage and physics
+	if (HasAuthority() && OutHit.bBlockingHit)
+	{
+		if (AActor* HitActor = OutHit.GetActor())
+		{
+			AController* InstigatorController = PawnOwner ? PawnOwner->GetController() : nullptr;
+			UGameplayStatics::ApplyPointDamage(HitActor, HitscanDamage, ShotDir, OutHit, InstigatorController, this, HitscanDamageType);
+		}
+
+		// give some physics impulse to the object
+		UPrimitiveComponent* HitComp = OutHit.GetComponent();
+		if (HitComp && HitComp->IsSimulatingPhysics())
+		{
+			HitComp->AddImpulseAtLocation(ShotDir * HitscanPhysicsForce, OutHit.ImpactPoint);
+		}
+	}
+
+	// pass control to BP for tracers and impact effects. Dedicated servers have nobody to show them to
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		BP_OnHitscanShot(Start, OutHit);
+	}
+}
+
+void AShooterWeapon::FireSpread(const FTransform& ShotTransform, float ShotAge)
+{
+	const FVector ShotDir = ShotTransform.GetRotation().GetForwardVector();
+	const float SpreadHalfAngle = FMath::DegreesToRadians(SpreadAngle);
+
+	// the pellets are fired together, so the characters only need rewinding once
+	FLagCompensationRewind Rewind;
+	const bool bRewound = RewindForShot(ShotAge, Rewind);
+
+	// each pellet is its own hitscan trace, scattered inside the cone
+	for (int32 Pellet = 0; Pellet < SpreadPellets; ++Pellet)
+	{
+		const FVector PelletDir = FMath::VRandCone(ShotDir, SpreadHalfAngle);
+
+		TraceHitscan(FTransform(PelletDir.Rotation(), ShotTransform.GetLocation(), FVector::OneVector), bRewound ? &Rewind : nullptr);
+	}
 }
 
-FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation) const
+bool AShooterWeapon::ShouldSimulateProjectilesInBatch() const
 {
-	// find the muzzle location
-	const FVector MuzzleLoc = FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+	// exploding projectiles need the full actor to resolve their radial damage
+	if (!bSimulateProjectilesInBatch || !ProjectileClass || ProjectileClass->GetDefaultObject<AShooterProjectile>()->ExplodesOnHit())
+	{
+		return false;
+	}
+
+	// batched shots have no actor to replicate. Networked games need fire events to show them on remote clients
+	if (GetNetMode() == NM_Standalone)
+	{
+		return true;
+	}
 
+	const UProjectileFireEventComponent* FireEvents = GetOwner() ? GetOwner()->FindComponentByClass<UProjectileFireEventComponent>() : nullptr;
+	return FireEvents && FireEvents->CanFireProjectile(ProjectileClass);
+}
+
+void AShooterWeapon::PrewarmProjectilePool()
+{
+	// clients don't spawn this weapon's projectiles
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	if (FireMode == EShooterFireMode::Projectile && !ShouldSimulateProjectilesInBatch())
+	{
+		if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			ProjectilePool->PrewarmPool(ProjectileClass, ProjectilePoolSize);
+		}
+	}
+}
+
+void AShooterWeapon::ApplyWeaponClassDefaults(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	const AShooterWeapon* Defaults = WeaponClass->GetDefaultObject<AShooterWeapon>();
+
+	// only native weapon parameters and meshes are swapped. Anything else the class adds would be silently missing
+	if (!ensureMsgf(!AddsBlueprintState(WeaponClass), TEXT("%s adds Blueprint variables or components that %s can't switch to. Move them to AShooterWeapon or into a data asset"),
+		*GetNameSafe(WeaponClass), *GetNameSafe(GetClass())))
+	{
+		UE_LOG(LogFirstPerson, Warning, TEXT("%s switched to %s without its Blueprint variables and components"), *GetName(), *GetNameSafe(WeaponClass));
+	}
+
+	// copy every editable weapon parameter. Visible only properties are the components, which are handled below
+	for (TFieldIterator<FProperty> It(AShooterWeapon::StaticClass(), EFieldIteratorFlags::ExcludeSuper); It; ++It)
+	{
+		if (It->HasAnyPropertyFlags(CPF_Edit) && !It->HasAnyPropertyFlags(CPF_EditConst))
+		{
+			It->CopyCompleteValue_InContainer(this, Defaults);
+		}
+	}
+
+	// swap the mesh assets instead of spawning a new set of components
+	auto CopyMesh = [](USkeletalMeshComponent* Mesh, const USkeletalMeshComponent* Source)
+	{
+		Mesh->SetSkeletalMeshAsset(Source->GetSkeletalMeshAsset());
+		Mesh->SetRelativeTransform(Source->GetRelativeTransform());
+		Mesh->EmptyOverrideMaterials();
+
+		for (int32 MaterialIndex = 0; MaterialIndex < Source->OverrideMaterials.Num(); ++MaterialIndex)
+		{
+			Mesh->SetMaterial(MaterialIndex, Source->OverrideMaterials[MaterialIndex]);
+		}
+	};
+
+	CopyMesh(FirstPersonMesh, Defaults->GetFirstPersonMesh());
+	CopyMesh(ThirdPersonMesh, Defaults->GetThirdPersonMesh());
+
+	EquippedClass = WeaponClass;
+
+	SelectFirePolicy();
+	PrewarmProjectilePool();
+}
+
+bool AShooterWeapon::AddsBlueprintState(TSubclassOf<AShooterWeapon> WeaponClass) const
+{
+	// every class the actor isn't already an instance of
+	for (UClass* Class = WeaponClass; Class && !GetClass()->IsChildOf(Class); Class = Class->GetSuperClass())
+	{
+		UBlueprintGeneratedClass* BlueprintClass = Cast<UBlueprintGeneratedClass>(Class);
+
+		if (!BlueprintClass)
+		{
+			continue;
+		}
+
+		// components added in the Blueprint, or overrides of a parent Blueprint's components
+		if ((BlueprintClass->SimpleConstructionScript && BlueprintClass->SimpleConstructionScript->GetAllNodes().Num() > 0) || BlueprintClass->GetInheritableComponentHandler())
+		{
+			return true;
+		}
+
+		// Blueprint variables. The event graph frame holds no user state
+		for (TFieldIterator<FProperty> It(BlueprintClass, EFieldIteratorFlags::ExcludeSuper); It; ++It)
+		{
+			if (It->GetFName() != TEXT("UberGraphFrame"))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+FVector AShooterWeapon::GetMuzzleLocation() const
+{
+	return FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+}
+
+FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& MuzzleLocation, const FVector& TargetLocation) const
+{
 	// calculate the spawn location ahead of the muzzle
-	const FVector SpawnLoc = MuzzleLoc + ((TargetLocation - MuzzleLoc).GetSafeNormal() * MuzzleOffset);
+	const FVector SpawnLoc = MuzzleLocation + ((TargetLocation - MuzzleLocation).GetSafeNormal() * MuzzleOffset);
 
 	// find the aim rotation vector while applying some variance to the target 
 	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (UKismetMathLibrary::RandomUnitVector() * AimVariance));
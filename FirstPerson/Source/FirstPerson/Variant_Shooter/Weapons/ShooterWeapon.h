@@ -13,6 +13,71 @@ class AShooterProjectile;
 class USkeletalMeshComponent;
 class UAnimMontage;
 class UAnimInstance;
+class UDamageType;
+class AShooterWeapon;
+struct FLagCompensationRewind;
+
+/** Fires one shot with the fire policies selected for a weapon. Returns true if the trigger wants another shot scheduled */
+using FShooterFireShotFunction = bool (*)(AShooterWeapon& Weapon, const FVector& MuzzleLocation, const FVector& TargetLocation, float ShotTime);
+
+/**
+ *  How a weapon delivers its shots
+ */
+UENUM(BlueprintType)
+enum class EShooterFireMode : uint8
+{
+	/** Spawns a projectile actor that travels to the target */
+	Projectile,
+
+	/** Resolves the shot instantly with a lag compensated trace on the server */
+	Hitscan,
+
+	/** Resolves several hitscan pellets spread in a cone */
+	Spread
+};
+
+/**
+ *  Compact inventory entry for a weapon the character owns but may not be holding
+ */
+USTRUCT()
+struct FShooterWeaponSlot
+{
+	GENERATED_BODY()
+
+	/** Weapon class this slot was picked up as */
+	UPROPERTY()
+	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Bullets left in the magazine */
+	UPROPERTY()
+	int32 Bullets = 0;
+
+	/** Game time of the last shot, so switching doesn't skip the refire cooldown */
+	UPROPERTY()
+	float TimeOfLastShot = 0.0f;
+};
+
+/**
+ *  Weapon state replicated to the owning client only
+ *  The owner predicts its ammo locally and reconciles it against this
+ */
+USTRUCT()
+struct FShooterWeaponState
+{
+	GENERATED_BODY()
+
+	/** Bullets left in the magazine on the server */
+	UPROPERTY()
+	uint8 Bullets = 0;
+
+	/** Number of shots the server has fired, wrapping. Lets the owner tell which of its predicted shots were accounted for */
+	UPROPERTY()
+	uint8 ShotSequence = 0;
+
+	/** Server world time of the server's last shot. Lets the owner line its refire cooldown up with the server's */
+	UPROPERTY()
+	float TimeOfLastShot = 0.0f;
+};
 
 /**
  *  Base class for a simple first person shooter weapon
@@ -42,12 +107,70 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Ammo")
 	TSubclassOf<AShooterProjectile> ProjectileClass;
 
+	/** Number of projectiles to pre-warm in the projectile pool when this weapon is spawned */
+	UPROPERTY(EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 200))
+	int32 ProjectilePoolSize = 10;
+
+	/** Selects between spawning projectiles or resolving shots with a hitscan trace */
+	UPROPERTY(EditAnywhere, Category="Ammo")
+	EShooterFireMode FireMode = EShooterFireMode::Projectile;
+
+	/**
+	 *  If true, projectiles are simulated by the batch subsystem instead of spawning actors. Exploding projectiles always spawn actors.
+	 *  In networked games the owner also needs a fire event component that can send the projectile class, so remote clients see the shots
+	 */
+	UPROPERTY(EditAnywhere, Category="Ammo", meta = (EditCondition = "FireMode == EShooterFireMode::Projectile"))
+	bool bSimulateProjectilesInBatch = false;
+
+	/** Optional actor to spawn at the impact point of batch simulated projectiles */
+	UPROPERTY(EditAnywhere, Category="Ammo", meta = (EditCondition = "bSimulateProjectilesInBatch"))
+	TSubclassOf<AActor> BatchedImpactActorClass;
+
+	/** Max range of hitscan shots */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode != EShooterFireMode::Projectile", ClampMin = 0, ClampMax = 100000, Units = "cm"))
+	float HitscanRange = 10000.0f;
+
+	/** Damage applied by hitscan shots */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode != EShooterFireMode::Projectile", ClampMin = 0, ClampMax = 100))
+	float HitscanDamage = 25.0f;
+
+	/** Physics force applied by hitscan shots */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode != EShooterFireMode::Projectile", ClampMin = 0, ClampMax = 50000))
+	float HitscanPhysicsForce = 100.0f;
+
+	/** Type of damage applied by hitscan shots */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode != EShooterFireMode::Projectile"))
+	TSubclassOf<UDamageType> HitscanDamageType;
+
+	/** Number of pellets in each spread shot. Each one deals the full hitscan damage */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode == EShooterFireMode::Spread", ClampMin = 1, ClampMax = 32))
+	int32 SpreadPellets = 8;
+
+	/** Cone half-angle the spread pellets are scattered in */
+	UPROPERTY(EditAnywhere, Category="Ammo|Hitscan", meta = (EditCondition = "FireMode == EShooterFireMode::Spread", ClampMin = 0, ClampMax = 45, Units = "Degrees"))
+	float SpreadAngle = 5.0f;
+
+	/** If true, the magazine never runs out */
+	UPROPERTY(EditAnywhere, Category="Ammo")
+	bool bInfiniteAmmo = false;
+
 	/** Number of bullets in a magazine */
 	UPROPERTY(EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 100))
 	int32 MagazineSize = 10;
 
-	/** Number of bullets in the current magazine */
+	/** Number of bullets in the current magazine. Predicted on the owning client */
 	int32 CurrentBullets = 0;
+
+	/** Authoritative ammo state, only replicated to the owner */
+	UPROPERTY(ReplicatedUsing=OnRep_WeaponState)
+	FShooterWeaponState WeaponState;
+
+	/** Shots fired locally by the owning client, wrapping. Compared against the server's shot sequence */
+	uint8 PredictedShotSequence = 0;
+
+	/** Shots fired, wrapping. Only replicated to the other clients, so they can play firing cosmetics */
+	UPROPERTY(ReplicatedUsing=OnRep_FireCounter)
+	uint8 FireCounter = 0;
 	
 	/** Animation montage to play when firing this weapon */
 	UPROPERTY(EditAnywhere, Category="Animation")
@@ -61,6 +184,13 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Animation")
 	TSubclassOf<UAnimInstance> ThirdPersonAnimInstanceClass;
 
+	/**
+	 *  If true, the AnimInstance classes implement anim layers and are linked into the character's own AnimInstance,
+	 *  instead of replacing it. Switching to this weapon then relinks layers instead of re-initializing the whole AnimInstance
+	 */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	bool bLinkAnimLayers = false;
+
 	/** Cone half-angle for variance while aiming */
 	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 90, Units = "Degrees"))
 	float AimVariance = 0.0f;
@@ -81,19 +211,45 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Refire")
 	bool bFullAuto = false;
 
+	/** Shots fired for each trigger pull when not full auto. More than one makes the weapon burst fire */
+	UPROPERTY(EditAnywhere, Category="Refire", meta = (EditCondition = "!bFullAuto", ClampMin = 1, ClampMax = 10))
+	int32 BurstCount = 1;
+
 	/** Time between shots for this weapon. Affects both full auto and semi auto modes */
 	UPROPERTY(EditAnywhere, Category="Refire", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
 	float RefireRate = 0.5f;
 
+	/** Max full auto shots fired in a single frame. Shots past this after a hitch carry over to the next frames */
+	UPROPERTY(EditAnywhere, Category="Refire", meta = (ClampMin = 1, ClampMax = 32))
+	int32 MaxShotsPerFrame = 8;
+
 	/** Game time of last shot fired, used to enforce refire rate on semi auto */
 	float TimeOfLastShot = 0.0f;
 
+	/** Game time the next full auto shot is due at. May fall between frames */
+	float NextShotTime = 0.0f;
+
+	/** Game time, muzzle location and aim target of the last scheduler update. Shots due since then are interpolated from these */
+	float LastScheduleTime = 0.0f;
+	FVector LastScheduleMuzzle = FVector::ZeroVector;
+	FVector LastScheduleTarget = FVector::ZeroVector;
+
 	/** If true, the weapon is currently firing */
 	bool bIsFiring = false;
 
-	/** Timer to handle full auto refiring */
+	/** Shots fired since the trigger was pulled */
+	int32 ShotsThisTrigger = 0;
+
+	/** Fire policies selected for the equipped class */
+	FShooterFireShotFunction FireShotFunction = nullptr;
+
+	/** Timer to handle the semi auto cooldown notification */
 	FTimerHandle RefireTimer;
 
+	/** Weapon class whose meshes and parameters this actor is currently using */
+	UPROPERTY(ReplicatedUsing=OnRep_EquippedClass)
+	TSubclassOf<AShooterWeapon> EquippedClass;
+
 	/** Cast pawn pointer to the owner for AI perception system interactions */
 	TObjectPtr<APawn> PawnOwner;
 
@@ -122,6 +278,36 @@ protected:
 	/** Gameplay Cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+	/** Runs the full auto fire scheduler */
+	virtual void Tick(float DeltaTime) override;
+
+public:
+
+	/** Sets up replication */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+
+	/** Asks the server to start firing. The owner keeps predicting its ammo in the meantime */
+	UFUNCTION(Server, Reliable)
+	void ServerStartFiring();
+
+	/** Asks the server to stop firing */
+	UFUNCTION(Server, Reliable)
+	void ServerStopFiring();
+
+	/** Reconciles the predicted ammo with the server's */
+	UFUNCTION()
+	void OnRep_WeaponState();
+
+	/** Plays firing cosmetics for other players' shots */
+	UFUNCTION()
+	void OnRep_FireCounter();
+
+	/** Takes on the weapon class the server switched to */
+	UFUNCTION()
+	void OnRep_EquippedClass();
+
 protected:
 
 	/** Called when the weapon's owner is destroyed */
@@ -142,19 +328,96 @@ public:
 	/** Stop firing this weapon */
 	void StopFiring();
 
+	/** Takes on the meshes and parameters of the slot's weapon class, then restores the slot's ammo and cooldown */
+	void LoadWeaponSlot(const FShooterWeaponSlot& Slot);
+
+	/** Writes this weapon's ammo and cooldown back into an inventory slot */
+	void SaveWeaponSlot(FShooterWeaponSlot& Slot) const;
+
 protected:
 
-	/** Fire the weapon */
-	virtual void Fire();
+	/** Policies are specialized at compile time and reach into the weapon directly */
+	template<typename TriggerPolicy, typename DeliveryPolicy, typename AmmoPolicy, typename WeaponType> friend struct TShooterFirePolicy;
+	friend struct FShooterProjectileDelivery;
+	friend struct FShooterHitscanDelivery;
+	friend struct FShooterSpreadDelivery;
+
+	/**
+	 *  Fires a single shot from the given muzzle location through the selected fire policies
+	 *  The shot time may fall between frames. Returns true if the trigger wants another shot scheduled
+	 */
+	bool FireShot(const FVector& MuzzleLocation, const FVector& TargetLocation, float ShotTime) { return FireShotFunction(*this, MuzzleLocation, TargetLocation, ShotTime); }
+
+	/** Picks the fire policies for the current trigger, delivery and ammo settings */
+	void SelectFirePolicy();
+
+	/** Returns how long ago a shot scheduled for the given time came due */
+	float GetShotAge(float ShotTime) const;
+
+	/** Records a shot: timing, counters, AI noise, montage and recoil */
+	void RecordShot(float ShotTime);
+
+	/** Publishes the shot's ammo and schedules the cooldown notification once the trigger is done */
+	void FinishShot(bool bKeepFiring);
 
 	/** Called when the refire rate time has passed while shooting semi auto weapons */
 	void FireCooldownExpired();
 
-	/** Fire a projectile towards the target location */
-	virtual void FireProjectile(const FVector& TargetLocation);
+	/** Takes one bullet out of the magazine, reloading it once it's empty */
+	void ConsumeBullet();
+
+	/** Copies the current ammo and last shot time into the replicated state */
+	void UpdateWeaponState();
+
+	/** Takes the server's last shot time as our own, converted to our world time */
+	void ApplyServerShotTime();
+
+	/** Passes control to Blueprint to play cosmetics for a shot fired by another player */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Simulated Shot"))
+	void BP_OnSimulatedShot();
+
+	/**
+	 *  Launches a projectile along the given transform, through the batch, fire event or pool path
+	 *  The projectile starts as far along its path as it would have flown since the shot was fired, ShotAge seconds ago
+	 */
+	void LaunchProjectile(const FTransform& ProjectileTransform, float ShotAge = 0.0f);
+
+	/** Resolves a hitscan shot along the given transform, rewinding characters on the server to when the shot was fired, ShotAge seconds ago */
+	void FireHitscan(const FTransform& ShotTransform, float ShotAge = 0.0f);
+
+	/** Resolves a spread of hitscan pellets scattered around the given transform. The pellets share a single rewind */
+	void FireSpread(const FTransform& ShotTransform, float ShotAge = 0.0f);
+
+	/** Rewinds the characters for a shot fired ShotAge seconds ago. Returns false if the shot isn't lag compensated */
+	bool RewindForShot(float ShotAge, FLagCompensationRewind& OutRewind) const;
+
+	/** Traces a single hitscan shot against the rewound characters, or the current world without a rewind, and applies its hit */
+	void TraceHitscan(const FTransform& ShotTransform, const FLagCompensationRewind* Rewind);
+
+	/** Moves a projectile's launch transform forward by the distance it flew in ShotAge seconds, stopping short of blocking geometry */
+	FTransform AdvanceLaunchTransform(const FTransform& ProjectileTransform, float Speed, float ShotAge) const;
+
+	/** Returns true if this weapon's projectiles should go through the batch subsystem */
+	bool ShouldSimulateProjectilesInBatch() const;
+
+	/** Pre-warms the server's projectile pool so the first shots don't spawn actors */
+	void PrewarmProjectilePool();
+
+	/** Copies the meshes and editable parameters from another weapon class's defaults */
+	void ApplyWeaponClassDefaults(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/** Returns true if the weapon class adds Blueprint variables or components this actor's class doesn't have. A class swap can't carry those over */
+	bool AddsBlueprintState(TSubclassOf<AShooterWeapon> WeaponClass) const;
+
+	/** Passes control to Blueprint to implement tracers and impact effects for hitscan shots */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Hitscan Shot"))
+	void BP_OnHitscanShot(const FVector& MuzzleLocation, const FHitResult& Hit);
+
+	/** Returns the current location of the first person muzzle socket */
+	FVector GetMuzzleLocation() const;
 
 	/** Calculates the spawn transform for projectiles shot by this weapon */
-	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation) const;
+	FTransform CalculateProjectileSpawnTransform(const FVector& MuzzleLocation, const FVector& TargetLocation) const;
 
 public:
 
@@ -172,6 +435,9 @@ public:
 	/** Returns the third person anim instance class */
 	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimInstanceClass() const;
 
+	/** Returns true if the anim instance classes should be linked as anim layers */
+	bool ShouldLinkAnimLayers() const { return bLinkAnimLayers; }
+
 	/** Returns the magazine size */
 	int32 GetMagazineSize() const { return MagazineSize; };
 
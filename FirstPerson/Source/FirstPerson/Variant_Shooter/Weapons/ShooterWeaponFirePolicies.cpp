@@ -0,0 +1,9 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponFirePolicies.h"
+
+FShooterFireShotFunction SelectShooterFirePolicy(bool bFullAuto, int32 BurstCount, EShooterFireMode FireMode, bool bInfiniteAmmo)
+{
+	return TShooterFirePolicySelector<AShooterWeapon, FShooterProjectileDelivery, FShooterHitscanDelivery, FShooterSpreadDelivery>::Select(bFullAuto, BurstCount, FireMode, bInfiniteAmmo);
+}
@@ -0,0 +1,170 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterWeapon.h"
+
+/**
+ *  Compile time weapon fire policies
+ *  A weapon's per shot path is assembled from a trigger, a delivery and an ammo policy.
+ *  Every combination is instantiated up front and the weapon keeps a pointer to the one matching its settings,
+ *  so a shot runs straight through without virtual calls or branches on settings that can't change mid-fire.
+ */
+
+/** Fires once per trigger pull */
+struct FShooterSemiAutoTrigger
+{
+	static FORCEINLINE bool KeepsFiring(int32 ShotsThisTrigger, int32 BurstCount) { return false; }
+};
+
+/** Keeps firing at the refire rate while the trigger is held */
+struct FShooterFullAutoTrigger
+{
+	static FORCEINLINE bool KeepsFiring(int32 ShotsThisTrigger, int32 BurstCount) { return true; }
+};
+
+/** Fires a fixed number of shots at the refire rate for each trigger pull */
+struct FShooterBurstTrigger
+{
+	static FORCEINLINE bool KeepsFiring(int32 ShotsThisTrigger, int32 BurstCount) { return ShotsThisTrigger < BurstCount; }
+};
+
+/** Launches a projectile */
+struct FShooterProjectileDelivery
+{
+	/** Clients wait for the server's projectile */
+	static constexpr bool bDeliversOnClients = false;
+
+	static FORCEINLINE void Deliver(AShooterWeapon& Weapon, const FTransform& ShotTransform, float ShotAge) { Weapon.LaunchProjectile(ShotTransform, ShotAge); }
+};
+
+/** Resolves a single hitscan trace */
+struct FShooterHitscanDelivery
+{
+	/** Clients trace cosmetically for tracers and impact effects */
+	static constexpr bool bDeliversOnClients = true;
+
+	static FORCEINLINE void Deliver(AShooterWeapon& Weapon, const FTransform& ShotTransform, float ShotAge) { Weapon.FireHitscan(ShotTransform, ShotAge); }
+};
+
+/** Resolves a spread of hitscan pellets */
+struct FShooterSpreadDelivery
+{
+	/** Clients trace cosmetically for tracers and impact effects */
+	static constexpr bool bDeliversOnClients = true;
+
+	static FORCEINLINE void Deliver(AShooterWeapon& Weapon, const FTransform& ShotTransform, float ShotAge) { Weapon.FireSpread(ShotTransform, ShotAge); }
+};
+
+/** Takes a bullet per shot and reloads the magazine once it's empty */
+struct FShooterMagazineAmmo
+{
+	static FORCEINLINE void Consume(int32& Bullets, int32 MagazineSize)
+	{
+		// if the clip is depleted, reload it
+		if (--Bullets <= 0)
+		{
+			Bullets = MagazineSize;
+		}
+	}
+};
+
+/** Never runs out */
+struct FShooterInfiniteAmmo
+{
+	static FORCEINLINE void Consume(int32& Bullets, int32 MagazineSize) {}
+};
+
+/**
+ *  A weapon's per shot path, specialized for a trigger, delivery and ammo policy
+ *  The weapon type is only swapped out by tests, which run the same path on a stub weapon
+ */
+template<typename TriggerPolicy, typename DeliveryPolicy, typename AmmoPolicy, typename WeaponType = AShooterWeapon>
+struct TShooterFirePolicy
+{
+	/** Ammo and trigger bookkeeping for a shot. Returns true if the trigger wants another shot scheduled */
+	static FORCEINLINE bool Advance(int32& Bullets, int32 MagazineSize, int32& ShotsThisTrigger, int32 BurstCount)
+	{
+		AmmoPolicy::Consume(Bullets, MagazineSize);
+		return TriggerPolicy::KeepsFiring(++ShotsThisTrigger, BurstCount);
+	}
+
+	/** Fires one shot. Matches FShooterFireShotFunction */
+	static bool FireShot(WeaponType& Weapon, const FVector& MuzzleLocation, const FVector& TargetLocation, float ShotTime)
+	{
+		// the server delivers every shot. Clients only deliver the ones with local cosmetics
+		if (DeliveryPolicy::bDeliversOnClients || Weapon.HasAuthority())
+		{
+			// shots that came due between frames are delivered late. The delivery makes up for how long ago they were fired
+			DeliveryPolicy::Deliver(Weapon, Weapon.CalculateProjectileSpawnTransform(MuzzleLocation, TargetLocation), Weapon.GetShotAge(ShotTime));
+		}
+
+		Weapon.RecordShot(ShotTime);
+
+		const bool bKeepFiring = Advance(Weapon.CurrentBullets, Weapon.MagazineSize, Weapon.ShotsThisTrigger, Weapon.BurstCount);
+
+		Weapon.FinishShot(bKeepFiring);
+
+		return bKeepFiring;
+	}
+};
+
+/**
+ *  Picks the fire policy instantiation for a weapon's settings, out of every trigger, delivery and ammo combination
+ */
+template<typename WeaponType, typename ProjectileDelivery, typename HitscanDelivery, typename SpreadDelivery>
+struct TShooterFirePolicySelector
+{
+	using FFireShotFunction = bool (*)(WeaponType& Weapon, const FVector& MuzzleLocation, const FVector& TargetLocation, float ShotTime);
+
+	/** Returns the instantiation matching the trigger, delivery and ammo settings */
+	static FFireShotFunction Select(bool bFullAuto, int32 BurstCount, EShooterFireMode FireMode, bool bInfiniteAmmo)
+	{
+		if (bFullAuto)
+		{
+			return SelectDelivery<FShooterFullAutoTrigger>(FireMode, bInfiniteAmmo);
+		}
+
+		if (BurstCount > 1)
+		{
+			return SelectDelivery<FShooterBurstTrigger>(FireMode, bInfiniteAmmo);
+		}
+
+		return SelectDelivery<FShooterSemiAutoTrigger>(FireMode, bInfiniteAmmo);
+	}
+
+private:
+
+	/** Picks the delivery and ammo policies for a trigger */
+	template<typename TriggerPolicy>
+	static FFireShotFunction SelectDelivery(EShooterFireMode FireMode, bool bInfiniteAmmo)
+	{
+		switch (FireMode)
+		{
+		case EShooterFireMode::Hitscan:
+			return SelectAmmo<TriggerPolicy, HitscanDelivery>(bInfiniteAmmo);
+
+		case EShooterFireMode::Spread:
+			return SelectAmmo<TriggerPolicy, SpreadDelivery>(bInfiniteAmmo);
+
+		default:
+			return SelectAmmo<TriggerPolicy, ProjectileDelivery>(bInfiniteAmmo);
+		}
+	}
+
+	/** Picks the ammo policy for a trigger and delivery */
+	template<typename TriggerPolicy, typename DeliveryPolicy>
+	static FFireShotFunction SelectAmmo(bool bInfiniteAmmo)
+	{
+		if (bInfiniteAmmo)
+		{
+			return &TShooterFirePolicy<TriggerPolicy, DeliveryPolicy, FShooterInfiniteAmmo, WeaponType>::FireShot;
+		}
+
+		return &TShooterFirePolicy<TriggerPolicy, DeliveryPolicy, FShooterMagazineAmmo, WeaponType>::FireShot;
+	}
+};
+
+/** Returns the fire policy instantiation matching a weapon's trigger, delivery and ammo settings */
+FShooterFireShotFunction SelectShooterFirePolicy(bool bFullAuto, int32 BurstCount, EShooterFireMode FireMode, bool bInfiniteAmmo);
@@ -0,0 +1,118 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponPreloader.h"
+#include "ShooterPickup.h"
+#include "FirstPerson.h"
+#include "Engine/World.h"
+#include "Engine/DataTable.h"
+#include "Engine/AssetManager.h"
+#include "EngineUtils.h"
+
+void UShooterWeaponPreloader::PreloadWeaponTable(const UDataTable* WeaponTable)
+{
+	if (!WeaponTable || WeaponTable->GetRowStruct() != FWeaponTableRow::StaticStruct())
+	{
+		return;
+	}
+
+	// each table only needs to be preloaded once
+	bool bAlreadyPreloaded = false;
+	PreloadedTables.Add(WeaponTable, &bAlreadyPreloaded);
+
+	if (bAlreadyPreloaded)
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> Paths;
+
+	WeaponTable->ForeachRow<FWeaponTableRow>(TEXT("PreloadWeaponTable"), [&Paths](const FName& Key, const FWeaponTableRow& WeaponData)
+	{
+		GetWeaponAssetPaths(WeaponData, Paths);
+	});
+
+	if (Paths.IsEmpty())
+	{
+		return;
+	}
+
+	if (NumPendingPreloads == 0)
+	{
+		PreloadStartTime = FPlatformTime::Seconds();
+	}
+
+	++NumPendingPreloads;
+
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths, FStreamableDelegate::CreateUObject(this, &UShooterWeaponPreloader::OnPreloadCompleted));
+
+	if (Handle)
+	{
+		PreloadHandles.Add(Handle);
+	}
+}
+
+TSharedPtr<FStreamableHandle> UShooterWeaponPreloader::RequestWeaponAssets(const FWeaponTableRow& WeaponData, FStreamableDelegate OnLoaded)
+{
+	TArray<FSoftObjectPath> Paths;
+	GetWeaponAssetPaths(WeaponData, Paths);
+
+	// nothing to wait for
+	if (Paths.IsEmpty())
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	// requests for assets already streaming join the preload's request
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths, MoveTemp(OnLoaded));
+}
+
+void UShooterWeaponPreloader::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// preload the tables used by the level's pickups before they request their own rows
+	for (TActorIterator<AShooterPickup> It(&InWorld); It; ++It)
+	{
+		PreloadWeaponTable(It->GetWeaponTable());
+	}
+}
+
+void UShooterWeaponPreloader::Deinitialize()
+{
+	// let the assets go with the world
+	for (const TSharedPtr<FStreamableHandle>& Handle : PreloadHandles)
+	{
+		Handle->ReleaseHandle();
+	}
+
+	PreloadHandles.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShooterWeaponPreloader::GetWeaponAssetPaths(const FWeaponTableRow& WeaponData, TArray<FSoftObjectPath>& OutPaths)
+{
+	if (!WeaponData.StaticMesh.IsNull())
+	{
+		OutPaths.AddUnique(WeaponData.StaticMesh.ToSoftObjectPath());
+	}
+
+	if (!WeaponData.WeaponToSpawn.IsNull())
+	{
+		OutPaths.AddUnique(WeaponData.WeaponToSpawn.ToSoftObjectPath());
+	}
+}
+
+void UShooterWeaponPreloader::OnPreloadCompleted()
+{
+	if (--NumPendingPreloads > 0)
+	{
+		return;
+	}
+
+	UE_LOG(LogFirstPerson, Log, TEXT("Weapon assets preloaded in %.2f s"), FPlatformTime::Seconds() - PreloadStartTime);
+
+	OnWeaponAssetsPreloaded.Broadcast();
+}
@@ -0,0 +1,70 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "ShooterWeaponPreloader.generated.h"
+
+class UDataTable;
+struct FWeaponTableRow;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FWeaponAssetsPreloadedDelegate);
+
+/**
+ *  Streams in weapon assets ahead of time
+ *  When the map starts, reads every weapon data table referenced by the level's pickups and issues async loads
+ *  for the pickup meshes and weapon classes. Loading a weapon class brings in its anim instance and projectile
+ *  classes with it. The handles are kept for the lifetime of the world so the assets stay resident.
+ *  Pickups request their own row's assets and activate once the handle completes, instead of loading them synchronously.
+ */
+UCLASS()
+class FIRSTPERSON_API UShooterWeaponPreloader : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Handles for every preload issued in this world */
+	TArray<TSharedPtr<FStreamableHandle>> PreloadHandles;
+
+	/** Data tables already preloaded */
+	TSet<TObjectKey<UDataTable>> PreloadedTables;
+
+	/** Number of preloads still streaming */
+	int32 NumPendingPreloads = 0;
+
+	/** Time the first preload was issued, to report how long streaming took */
+	double PreloadStartTime = 0.0;
+
+public:
+
+	/** Broadcast once every weapon asset requested at map load is resident */
+	UPROPERTY(BlueprintAssignable, Category="Weapons")
+	FWeaponAssetsPreloadedDelegate OnWeaponAssetsPreloaded;
+
+	/** Issues async loads for the assets of every row in a weapon data table */
+	void PreloadWeaponTable(const UDataTable* WeaponTable);
+
+	/**
+	 *  Issues an async load for the assets of a single weapon row
+	 *  The delegate is called once they're resident
+	 */
+	TSharedPtr<FStreamableHandle> RequestWeaponAssets(const FWeaponTableRow& WeaponData, FStreamableDelegate OnLoaded);
+
+	/** Returns true if every weapon asset requested at map load is resident */
+	UFUNCTION(BlueprintPure, Category="Weapons")
+	bool AreWeaponAssetsPreloaded() const { return NumPendingPreloads == 0; }
+
+	//~Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	//~End UWorldSubsystem interface
+
+protected:
+
+	/** Collects the soft references of a weapon row */
+	static void GetWeaponAssetPaths(const FWeaponTableRow& WeaponData, TArray<FSoftObjectPath>& OutPaths);
+
+	/** Called when one of the map load preloads completes */
+	void OnPreloadCompleted();
+};
@@ -11,5 +11,8 @@ public class FirstPersonEditorTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V5;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_6;
 		ExtraModuleNames.Add("FirstPerson");
+
+		// gameplay state replicates through push model
+		bWithPushModel = true;
 	}
 }